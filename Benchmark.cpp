@@ -0,0 +1,272 @@
+#include "Benchmark.h"
+#include <iostream>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+// what NodeCoord used to look like, kept here only to compare against
+struct LegacyNodeCoord {
+    int id;
+    double x, y;
+    double rawX, rawY;
+};
+
+// hardware cache miss counter for this thread, linux only
+// count() returns -1 if perf events aren't available (other OS, container, paranoid setting)
+class CacheMissCounter {
+public:
+    CacheMissCounter() {
+#ifdef __linux__
+        perf_event_attr attr{};
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+    }
+    ~CacheMissCounter() {
+#ifdef __linux__
+        if (fd != -1) {
+            close(fd);
+        }
+#endif
+    }
+    void start() {
+#ifdef __linux__
+        if (fd != -1) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+    long long count() {
+        long long value = -1;
+#ifdef __linux__
+        if (fd != -1) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fd, &value, sizeof(value)) != sizeof(value)) {
+                value = -1;
+            }
+        }
+#endif
+        return value;
+    }
+
+private:
+    int fd = -1;
+};
+
+static string missText(long long misses) {
+    return misses < 0 ? "n/a" : to_string(misses);
+}
+
+int runCoordBenchmark(const string& coFile, const string& grFile, int queries) {
+    DIMACSData data = Graph::loadDIMACS(coFile, grFile);
+    if (data.nodes.empty()) {
+        return 1;
+    }
+    Graph graph(data.edges, data.numNodes);
+    CoordStore coords(data.nodes, graph);
+
+    vector<LegacyNodeCoord> legacy(data.nodes.size());
+    for (auto& n : data.nodes) {
+        legacy[n.id] = {n.id, 0, 0, (double)n.rawX, (double)n.rawY};
+    }
+
+    size_t arcs = 0;
+    for (auto& list : graph.adjList) {
+        arcs += list.size();
+    }
+
+    cout << "\n===== COORDINATE LAYOUT =====" << endl;
+    cout << "Old NodeCoord: " << sizeof(LegacyNodeCoord) << " bytes/node, "
+         << sizeof(LegacyNodeCoord) * legacy.size() / 1024 << " KB" << endl;
+    cout << "NodeCoord:     " << sizeof(NodeCoord) << " bytes/node, "
+         << sizeof(NodeCoord) * data.nodes.size() / 1024 << " KB" << endl;
+    cout << "CoordStore:    " << 2 * sizeof(int32_t) << " bytes/node, "
+         << 2 * sizeof(int32_t) * coords.x.size() / 1024 << " KB" << endl;
+    cout << "Adjacency:     " << sizeof(pair<int, int>) << " bytes/edge, "
+         << sizeof(pair<int, int>) * arcs / 1024 << " KB" << endl;
+
+    // heuristic over every neighbor list, visited in random order like a search would
+    mt19937 rng(7);
+    vector<int> order(graph.numVertices);
+    for (int i = 0; i < graph.numVertices; i++) {
+        order[i] = i;
+    }
+    shuffle(order.begin(), order.end(), rng);
+    int destX = coords.x[order[0]];
+    int destY = coords.y[order[0]];
+    float scale = 0.1f;
+    CacheMissCounter counter;
+
+    double legacySum = 0;
+    counter.start();
+    auto start = chrono::high_resolution_clock::now();
+    for (int u : order) {
+        for (auto& neighbor : graph.adjList[u]) {
+            double dx = legacy[neighbor.first].rawX - destX;
+            double dy = legacy[neighbor.first].rawY - destY;
+            legacySum += sqrt(dx * dx + dy * dy) * scale;
+        }
+    }
+    auto end = chrono::high_resolution_clock::now();
+    long long legacyMisses = counter.count();
+    double legacyMs = chrono::duration<double, milli>(end - start).count();
+
+    double storeSum = 0;
+    vector<int32_t> neighborX, neighborY;
+    vector<float> h;
+    counter.start();
+    start = chrono::high_resolution_clock::now();
+    for (int u : order) {
+        const vector<pair<int, int>>& neighbors = graph.adjList[u];
+        int degree = neighbors.size();
+        neighborX.resize(degree);
+        neighborY.resize(degree);
+        h.resize(degree);
+        for (int i = 0; i < degree; i++) {
+            neighborX[i] = coords.x[neighbors[i].first];
+            neighborY[i] = coords.y[neighbors[i].first];
+        }
+        distanceKernel(neighborX.data(), neighborY.data(), degree, destX, destY, scale, h.data());
+        for (int i = 0; i < degree; i++) {
+            storeSum += h[i];
+        }
+    }
+    end = chrono::high_resolution_clock::now();
+    long long storeMisses = counter.count();
+    double storeMs = chrono::duration<double, milli>(end - start).count();
+
+    cout << "\nHeuristic over " << arcs << " edges (checksums " << (long long)legacySum << " / "
+         << (long long)storeSum << ")" << endl;
+    cout << "Old NodeCoord: " << legacyMs << " ms, cache misses " << missText(legacyMisses) << endl;
+    cout << "CoordStore:    " << storeMs << " ms, cache misses " << missText(storeMisses) << endl;
+
+    // end to end A*
+    uniform_int_distribution<int> pick(0, graph.numVertices - 1);
+    vector<pair<int, int>> pairs;
+    for (int i = 0; i < queries; i++) {
+        pairs.push_back({pick(rng), pick(rng)});
+    }
+
+    counter.start();
+    start = chrono::high_resolution_clock::now();
+    for (auto& q : pairs) {
+        graph.aStarPath(q.first, q.second, coords);
+    }
+    end = chrono::high_resolution_clock::now();
+    long long aStarMisses = counter.count();
+    double aStarMs = chrono::duration<double, milli>(end - start).count();
+
+    cout << "\nA*: " << aStarMs / max(queries, 1) << " ms/query over " << queries << " random pairs, cache misses "
+         << missText(aStarMisses) << endl;
+    cout << "=============================" << endl;
+    return 0;
+}
+
+int runBatchBenchmark(const string& coFile, const string& grFile, int src, int numTargets, int numSources) {
+    DIMACSData data = Graph::loadDIMACS(coFile, grFile);
+    if (data.nodes.empty()) {
+        return 1;
+    }
+    Graph graph(data.edges, data.numNodes);
+    CoordStore coords(data.nodes, graph);
+    if (!graph.isNode(src)) {
+        cerr << "Error: Unknown source " << src << endl;
+        return 1;
+    }
+
+    mt19937 rng(11);
+    uniform_int_distribution<int> pick(0, graph.numVertices - 1);
+    vector<int> targets;
+    for (int i = 0; i < numTargets; i++) {
+        targets.push_back(pick(rng));
+    }
+
+    // depots close to src (breadth first from it) and depots spread over the whole map
+    vector<int> nearbySources = {src};
+    vector<bool> seen(graph.numVertices, false);
+    seen[src] = true;
+    for (int i = 0; i < (int)nearbySources.size() && (int)nearbySources.size() < numSources; i++) {
+        for (auto& neighbor : graph.adjList[nearbySources[i]]) {
+            if (!seen[neighbor.first] && (int)nearbySources.size() < numSources) {
+                seen[neighbor.first] = true;
+                nearbySources.push_back(neighbor.first);
+            }
+        }
+    }
+    vector<int> randomSources = {src};
+    while ((int)randomSources.size() < numSources) {
+        randomSources.push_back(pick(rng));
+    }
+
+    auto timeMs = [](const function<void()>& f) {
+        auto start = chrono::high_resolution_clock::now();
+        f();
+        auto end = chrono::high_resolution_clock::now();
+        return chrono::duration<double, milli>(end - start).count();
+    };
+    auto perSecond = [](int queries, double ms) {
+        return ms > 0 ? queries * 1000.0 / ms : 0;
+    };
+
+    vector<int> oneByOne(numTargets);
+    double dijkstraMs = timeMs([&] {
+        for (int j = 0; j < numTargets; j++) {
+            oneByOne[j] = graph.pathCost(graph.dijkstraPath(src, targets[j]));
+        }
+    });
+    double aStarMs = timeMs([&] {
+        for (int j = 0; j < numTargets; j++) {
+            graph.aStarPath(src, targets[j], coords);
+        }
+    });
+    vector<int> batch;
+    double toManyMs = timeMs([&] { batch = graph.dijkstraToMany(src, targets); });
+    bool ok = batch == oneByOne;
+
+    cout << "\n===== BATCH QUERIES =====" << endl;
+    cout << "Source " << src << " to " << numTargets << " targets:" << endl;
+    cout << "  Dijkstra one by one: " << dijkstraMs << " ms (" << perSecond(numTargets, dijkstraMs) << " queries/s)" << endl;
+    cout << "  A* one by one:       " << aStarMs << " ms (" << perSecond(numTargets, aStarMs) << " queries/s)" << endl;
+    cout << "  One-to-many:         " << toManyMs << " ms (" << perSecond(numTargets, toManyMs) << " queries/s), "
+         << dijkstraMs / max(toManyMs, 1e-9) << "x vs dijkstra, " << aStarMs / max(toManyMs, 1e-9) << "x vs A*"
+         << (ok ? "" : "  DISTANCES DIFFER") << endl;
+
+    // the lanes share a scan only while their searches overlap, so it pays off most for nearby sources
+    vector<pair<string, vector<int>>> sourceSets = {{"nearby", nearbySources}, {"random", randomSources}};
+    for (auto& sourceSet : sourceSets) {
+        const vector<int>& sources = sourceSet.second;
+        int queries = numTargets * sources.size();
+
+        vector<vector<int>> perSource(sources.size());
+        double perSourceMs = timeMs([&] {
+            for (int i = 0; i < (int)sources.size(); i++) {
+                perSource[i] = graph.dijkstraToMany(sources[i], targets);
+            }
+        });
+        vector<vector<int>> lanes;
+        double lanesMs = timeMs([&] { lanes = graph.multiSourceDistances(sources, targets); });
+        ok &= lanes == perSource;
+
+        cout << sources.size() << " " << sourceSet.first << " sources to the same targets:" << endl;
+        cout << "  One-to-many per source: " << perSourceMs << " ms (" << perSecond(queries, perSourceMs)
+             << " queries/s)" << endl;
+        cout << "  " << SEARCH_LANES << " lane searches:       " << lanesMs << " ms (" << perSecond(queries, lanesMs)
+             << " queries/s), " << perSourceMs / max(lanesMs, 1e-9) << "x"
+             << (lanes == perSource ? "" : "  DISTANCES DIFFER") << endl;
+    }
+    cout << "=========================" << endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,17 @@
+#include "Graph.h"
+using namespace std;
+
+#ifndef PROJECT3_BENCHMARK_H
+#define PROJECT3_BENCHMARK_H
+
+// Compares the old 40 byte NodeCoord layout with CoordStore on the NY map:
+// memory per node, time and cache misses of the heuristic over real
+// neighbor lists, and average A* query time over random pairs.
+int runCoordBenchmark(const string& coFile, const string& grFile, int queries);
+
+// Throughput of batch queries on the NY map: src to numTargets random targets one by one
+// (dijkstra, A*) vs one dijkstraToMany, then numSources sources (nearby ones and random ones)
+// to the same targets with dijkstraToMany per source vs multiSourceDistances.
+int runBatchBenchmark(const string& coFile, const string& grFile, int src, int numTargets, int numSources);
+
+#endif //PROJECT3_BENCHMARK_H
@@ -2,6 +2,7 @@
 #include <iostream>
 #include <set>
 #include <limits>
+#include <climits>
 #include <algorithm>
 using namespace std;
 
@@ -82,8 +83,11 @@ vector<Edge> Graph::loadEdges(const string& filename, int& numNodes, int& numEdg
 DIMACSData Graph::loadDIMACS(const string& coFile, const string& grFile) {
     DIMACSData data;
 
-    // Load coordinates
+    // Load coordinates, sorted by id so nodes[i] is node i
     data.nodes = loadCoordinates(coFile);
+    sort(data.nodes.begin(), data.nodes.end(), [](const NodeCoord& a, const NodeCoord& b) {
+        return a.id < b.id;
+    });
 
     // Load edges
     data.edges = loadEdges(grFile, data.numNodes, data.numEdges);
@@ -107,8 +111,136 @@ DIMACSData Graph::loadDIMACS(const string& coFile, const string& grFile) {
     return data;
 }
 
+// iterative tarjan (the recursive one runs out of stack on big maps) plus a BFS for the weak components
+Components findComponents(int n, const function<int(int, int)>& arcHead) {
+    Components result;
+    result.sccOf.assign(n, -1);
+
+    vector<int> index(n, -1);
+    vector<int> low(n, 0);
+    vector<bool> onStack(n, false);
+    vector<int> stack;
+    vector<pair<int, int>> callStack;  // (node, index of the next arc to look at)
+    int counter = 0;
+
+    for (int root = 0; root < n; root++) {
+        if (index[root] != -1) {
+            continue;
+        }
+        index[root] = low[root] = counter++;
+        stack.push_back(root);
+        onStack[root] = true;
+        callStack.push_back({root, 0});
+
+        while (!callStack.empty()) {
+            int v = callStack.back().first;
+            int& next = callStack.back().second;
+
+            int w = arcHead(v, next);
+            if (w != -1) {
+                next++;
+                if (index[w] == -1) {
+                    index[w] = low[w] = counter++;
+                    stack.push_back(w);
+                    onStack[w] = true;
+                    callStack.push_back({w, 0});
+                } else if (onStack[w]) {
+                    low[v] = min(low[v], index[w]);
+                }
+                continue;
+            }
+
+            // done with v, pop its component if it's the root of one
+            callStack.pop_back();
+            if (low[v] == index[v]) {
+                int size = 0;
+                int w;
+                do {
+                    w = stack.back();
+                    stack.pop_back();
+                    onStack[w] = false;
+                    result.sccOf[w] = result.numSCCs;
+                    size++;
+                } while (w != v);
+                if (size > result.largestSCCSize) {
+                    result.largestSCCSize = size;
+                    result.largestSCC = result.numSCCs;
+                }
+                result.numSCCs++;
+            }
+            if (!callStack.empty()) {
+                int parent = callStack.back().first;
+                low[parent] = min(low[parent], low[v]);
+            }
+        }
+    }
+
+    // weak components with union find, so there's no need for the reverse arcs
+    vector<int>& root = index;
+    for (int v = 0; v < n; v++) {
+        root[v] = v;
+    }
+    auto findRoot = [&](int v) {
+        while (root[v] != v) {
+            root[v] = root[root[v]];
+            v = root[v];
+        }
+        return v;
+    };
+    for (int u = 0; u < n; u++) {
+        for (int i = 0, w; (w = arcHead(u, i)) != -1; i++) {
+            int a = findRoot(u);
+            int b = findRoot(w);
+            if (a != b) {
+                root[max(a, b)] = min(a, b);
+            }
+        }
+    }
+    result.wccOf.assign(n, -1);
+    vector<int>& idOfRoot = low;
+    fill(idOfRoot.begin(), idOfRoot.end(), -1);
+    for (int v = 0; v < n; v++) {
+        int r = findRoot(v);
+        if (idOfRoot[r] == -1) {
+            idOfRoot[r] = result.numWCCs++;
+        }
+        result.wccOf[v] = idOfRoot[r];
+    }
+    return result;
+}
+
+void Graph::computeComponents() {
+    Components components = findComponents(numVertices, [&](int v, int i) {
+        return i < (int)adjList[v].size() ? adjList[v][i].first : -1;
+    });
+    sccOf = move(components.sccOf);
+    wccOf = move(components.wccOf);
+    numSCCs = components.numSCCs;
+    numWCCs = components.numWCCs;
+    largestSCC = components.largestSCC;
+    largestSCCSize = components.largestSCCSize;
+
+    cout << "Components: " << numSCCs << " strongly connected (largest has " << largestSCCSize << " of "
+         << numVertices << " nodes), " << numWCCs << " weakly connected" << endl;
+}
+
+vector<Edge> Graph::largestSCCEdges() const {
+    vector<Edge> edges;
+    for (int u = 0; u < numVertices; u++) {
+        if (sccOf[u] != largestSCC) {
+            continue;
+        }
+        for (auto& neighbor : adjList[u]) {
+            if (sccOf[neighbor.first] == largestSCC) {
+                edges.emplace_back(u, neighbor.first, neighbor.second);
+            }
+        }
+    }
+    return edges;
+}
+
 int Graph::dijkstra(int src, int dest, vector<sf::VertexArray>& lines, map<pair<int, int>, int>& lineMapper) {
-    if (adjList[src].empty() || adjList[dest].empty()) {
+    if (!mayReach(src, dest)) {
         cout << "No path found" << endl;
         return -1;
     }
@@ -153,70 +285,95 @@ int Graph::dijkstra(int src, int dest, vector<sf::VertexArray>& lines, map<pair<
     return dist[dest];
 }
 
-int Graph::two_way_dijkstra(int src, int dest, vector<sf::VertexArray> &lines, map<pair<int, int>, int> &lineMapper) {
-    if (adjList[src].empty() || adjList[dest].empty()) {
-        cout << "No path found" << endl;
-        return -1;
-    }
+// bidirectional search shared by two_way_dijkstra and twoWayDijkstraPath
+// the backward side runs on reverseArcIndex so one-way streets work too
+// fills the parent arrays and the meeting node, returns the distance or INT_MAX
+int Graph::twoWaySearch(int src, int dest, vector<int>& p_src, vector<int>& p_dest, int& mid) {
     priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> pq_src; //pair - (dist, vertex)
     priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> pq_dest;
     vector<int> dist_src(numVertices, INT_MAX);
     vector<int> dist_dest(numVertices, INT_MAX);
-    vector<int> p_src(numVertices, -1);
-    vector<int> p_dest(numVertices, -1);
+    p_src.assign(numVertices, -1);
+    p_dest.assign(numVertices, -1);
 
-    pq_src.push(make_pair(0, src));
-    pq_dest.push(make_pair(0, dest));
+    pq_src.push({0, src});
+    pq_dest.push({0, dest});
     dist_src[src] = 0;
     dist_dest[dest] = 0;
-    set<int> visited_forward;
-    set<int> visited_backward;
-    int mid_point;
-    int min_dist = INT_MAX;
 
+    mid = -1;
+    int minDist = INT_MAX;
+    if (src == dest) {
+        mid = src;
+        return 0;
+    }
+
+    // if either side runs out, it has settled everything it can reach,
+    // and dest (or src) was checked as a meeting point when it got its final distance
     while (!pq_src.empty() && !pq_dest.empty()) {
-        pair<int, int> current_src = pq_src.top();
-        pair<int, int> current_dest = pq_dest.top();
+        // nothing left in the queues can beat the best meeting point
+        if (pq_src.top().first + pq_dest.top().first >= minDist) {
+            break;
+        }
+
+        int d_src = pq_src.top().first;
+        int u_src = pq_src.top().second;
         pq_src.pop();
-        pq_dest.pop();
-        int u_src = current_src.second; //vertex
-        int u_dest = current_dest.second; //vertex
-
-        visited_forward.insert(u_src);
-        visited_backward.insert(u_dest);
-
-        for (auto it_src = adjList[u_src].begin(); it_src != adjList[u_src].end(); ++it_src) {
-
-            int v_src = it_src->first; //neighbor
-            int w_src = it_src->second; //weight
-            if (dist_src[v_src] > dist_src[u_src] + w_src) {
-                dist_src[v_src] = dist_src[u_src] + w_src;
-                pq_src.push(make_pair(dist_src[v_src], v_src));
-                p_src[v_src] = u_src;
-                if (visited_backward.count(v_src) && dist_src[u_src] + w_src + dist_dest[v_src] < min_dist) {
-                    mid_point = v_src;
-                    min_dist = dist_src[u_src] + dist_dest[v_src] + w_src;
+        if (d_src <= dist_src[u_src]) {
+            for (auto& nb : adjList[u_src]) {
+                int v = nb.first;
+                int w = nb.second;
+                if (dist_src[v] > d_src + w) {
+                    dist_src[v] = d_src + w;
+                    pq_src.push({dist_src[v], v});
+                    p_src[v] = u_src;
+                    if (dist_dest[v] != INT_MAX && dist_src[v] + dist_dest[v] < minDist) {
+                        mid = v;
+                        minDist = dist_src[v] + dist_dest[v];
+                    }
                 }
             }
         }
 
-        for (auto it_dest = adjList[u_dest].begin(); it_dest != adjList[u_dest].end(); ++it_dest) {
-            int v_dest = it_dest->first; //neighbor
-            int w_dest = it_dest->second; //weight
-            if (dist_dest[v_dest] > dist_dest[u_dest] + w_dest) {
-                dist_dest[v_dest] = dist_dest[u_dest] + w_dest;
-                pq_dest.push(make_pair(dist_dest[v_dest], v_dest));
-                p_dest[v_dest] = u_dest;
-                if (visited_forward.count(v_dest) && dist_dest[u_dest] + w_dest + dist_src[v_dest] < min_dist) {
-                    mid_point = v_dest;
-                    min_dist = dist_dest[u_dest] + dist_src[v_dest] + w_dest;
+        int d_dest = pq_dest.top().first;
+        int u_dest = pq_dest.top().second;
+        pq_dest.pop();
+        if (d_dest <= dist_dest[u_dest]) {
+            for (auto& in : reverseArcIndex[u_dest]) {
+                int v = in.first;
+                int w = adjList[v][in.second].second;
+                if (dist_dest[v] > d_dest + w) {
+                    dist_dest[v] = d_dest + w;
+                    pq_dest.push({dist_dest[v], v});
+                    p_dest[v] = u_dest;
+                    if (dist_src[v] != INT_MAX && dist_src[v] + dist_dest[v] < minDist) {
+                        mid = v;
+                        minDist = dist_src[v] + dist_dest[v];
+                    }
                 }
             }
         }
-        if (dist_src[u_src] + dist_dest[u_dest] >= min_dist) {
+
+        if (pq_src.empty() || pq_dest.empty()) {
             break;
         }
     }
+    return minDist;
+}
+
+int Graph::two_way_dijkstra(int src, int dest, vector<sf::VertexArray> &lines, map<pair<int, int>, int> &lineMapper) {
+    if (!mayReach(src, dest)) {
+        cout << "No path found" << endl;
+        return -1;
+    }
+    vector<int> p_src;
+    vector<int> p_dest;
+    int mid_point;
+    int min_dist = twoWaySearch(src, dest, p_src, p_dest, mid_point);
+    if (min_dist == INT_MAX) {
+        cout << "No path found" << endl;
+        return -1;
+    }
 
     // color the path
     int vertex_src = mid_point;
@@ -230,7 +387,7 @@ int Graph::two_way_dijkstra(int src, int dest, vector<sf::VertexArray> &lines, m
         vertex_src = p_src[vertex_src];
     }
     while (p_dest[vertex_dest] != -1) {
-        auto it = lineMapper.find({p_dest[vertex_dest], vertex_dest});
+        auto it = lineMapper.find({vertex_dest, p_dest[vertex_dest]});
         if (it != lineMapper.end() && it->second < (int)lines.size()) {
             lines[it->second][0].color = sf::Color(255, 255, 0);  // yellow
             lines[it->second][1].color = sf::Color(255, 255, 0);
@@ -243,7 +400,7 @@ int Graph::two_way_dijkstra(int src, int dest, vector<sf::VertexArray> &lines, m
 // returns the path as a vector of node ids
 vector<int> Graph::dijkstraPath(int src, int dest) {
     vector<int> path;
-    if (adjList[src].empty() || adjList[dest].empty()) {
+    if (!mayReach(src, dest)) {
         return path;
     }
 
@@ -287,122 +444,269 @@ vector<int> Graph::dijkstraPath(int src, int dest) {
 
 vector<int> Graph::twoWayDijkstraPath(int src, int dest) {
     vector<int> path;
-    if (adjList[src].empty() || adjList[dest].empty()) {
+    if (!mayReach(src, dest)) {
         return path;
     }
 
-    priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> pq_src;
-    priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> pq_dest;
-    vector<int> dist_src(numVertices, INT_MAX);
-    vector<int> dist_dest(numVertices, INT_MAX);
-    vector<int> p_src(numVertices, -1);
-    vector<int> p_dest(numVertices, -1);
+    vector<int> p_src;
+    vector<int> p_dest;
+    int mid;
+    if (twoWaySearch(src, dest, p_src, p_dest, mid) == INT_MAX) {
+        return path;
+    }
 
-    pq_src.push({0, src});
-    pq_dest.push({0, dest});
-    dist_src[src] = 0;
-    dist_dest[dest] = 0;
+    // build path from src to mid
+    int node = mid;
+    while (node != -1) {
+        path.push_back(node);
+        node = p_src[node];
+    }
+    reverse(path.begin(), path.end());
 
-    set<int> visited_fwd;
-    set<int> visited_bwd;
-    int mid = -1;
-    int minDist = INT_MAX;
+    // build path from mid to dest
+    node = p_dest[mid];
+    while (node != -1) {
+        path.push_back(node);
+        node = p_dest[node];
+    }
 
-    while (!pq_src.empty() && !pq_dest.empty()) {
-        int u_src = pq_src.top().second;
-        int u_dest = pq_dest.top().second;
-        pq_src.pop();
-        pq_dest.pop();
+    return path;
+}
 
-        visited_fwd.insert(u_src);
-        visited_bwd.insert(u_dest);
-
-        for (auto& nb : adjList[u_src]) {
-            int v = nb.first;
-            int w = nb.second;
-            if (dist_src[v] > dist_src[u_src] + w) {
-                dist_src[v] = dist_src[u_src] + w;
-                pq_src.push({dist_src[v], v});
-                p_src[v] = u_src;
-                if (visited_bwd.count(v) && dist_src[u_src] + w + dist_dest[v] < minDist) {
-                    mid = v;
-                    minDist = dist_src[u_src] + w + dist_dest[v];
-                }
+vector<int> Graph::dijkstraToMany(int src, const vector<int>& targets) {
+    vector<int> result(targets.size(), -1);
+    if (!isNode(src)) {
+        return result;
+    }
+
+    // count each target once, the search can stop when they're all settled
+    // targets the component index rules out would never settle, so they don't count
+    vector<bool> isTarget(numVertices, false);
+    int remaining = 0;
+    for (int t : targets) {
+        if (mayReach(src, t) && !isTarget[t]) {
+            isTarget[t] = true;
+            remaining++;
+        }
+    }
+
+    priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> pq;
+    vector<int> dist(numVertices, INT_MAX);
+    pq.push({0, src});
+    dist[src] = 0;
+
+    while (!pq.empty() && remaining > 0) {
+        int d = pq.top().first;
+        int u = pq.top().second;
+        pq.pop();
+        if (d > dist[u]) {
+            continue;
+        }
+        if (isTarget[u]) {
+            remaining--;
+        }
+
+        for (auto& neighbor : adjList[u]) {
+            int v = neighbor.first;
+            int w = neighbor.second;
+            if (dist[v] > d + w) {
+                dist[v] = d + w;
+                pq.push({dist[v], v});
             }
         }
+    }
+
+    for (int j = 0; j < (int)targets.size(); j++) {
+        if (isNode(targets[j]) && isTarget[targets[j]] && dist[targets[j]] != INT_MAX) {
+            result[j] = dist[targets[j]];
+        }
+    }
+    return result;
+}
+
+vector<vector<int>> Graph::multiSourceDistances(const vector<int>& sources, const vector<int>& targets) {
+    vector<vector<int>> result(sources.size(), vector<int>(targets.size(), -1));
+    for (int first = 0; first < (int)sources.size(); first += SEARCH_LANES) {
+        int count = min(SEARCH_LANES, (int)sources.size() - first);
+        vector<vector<int>> batch;
+        laneSearch(&sources[first], count, targets, batch);
+        for (int lane = 0; lane < count; lane++) {
+            result[first + lane] = batch[lane];
+        }
+    }
+    return result;
+}
+
+// Runs up to SEARCH_LANES dijkstras at once. dist is interleaved (dist[v * SEARCH_LANES + lane])
+// so one pass over a node's edges updates every lane with a short loop the compiler vectorizes.
+// A node gets queued with the smallest lane distance that just improved and is rescanned
+// until no lane improves, so a node can be scanned more than once.
+void Graph::laneSearch(const int* sources, int count, const vector<int>& targets, vector<vector<int>>& result) {
+    const int L = SEARCH_LANES;
+    const int INF = INT_MAX / 2;  // room to add an edge weight without overflowing
+
+    vector<int> dist((size_t)numVertices * L, INF);
+    vector<bool> dirty(numVertices, false);
+    priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> pq;
+
+    for (int lane = 0; lane < count; lane++) {
+        if (isNode(sources[lane])) {
+            dist[(size_t)sources[lane] * L + lane] = 0;
+            dirty[sources[lane]] = true;
+            pq.push({0, sources[lane]});
+        }
+    }
 
-        for (auto& nb : adjList[u_dest]) {
-            int v = nb.first;
-            int w = nb.second;
-            if (dist_dest[v] > dist_dest[u_dest] + w) {
-                dist_dest[v] = dist_dest[u_dest] + w;
-                pq_dest.push({dist_dest[v], v});
-                p_dest[v] = u_dest;
-                if (visited_fwd.count(v) && dist_dest[u_dest] + w + dist_src[v] < minDist) {
-                    mid = v;
-                    minDist = dist_dest[u_dest] + w + dist_src[v];
+    // largest distance to any target over the used lanes, once the queue is past it nothing changes
+    // pairs the component index rules out are left out, they'd keep the bound at INF
+    auto targetBound = [&]() {
+        int bound = 0;
+        for (int t : targets) {
+            for (int lane = 0; lane < count; lane++) {
+                if (mayReach(sources[lane], t)) {
+                    bound = max(bound, dist[(size_t)t * L + lane]);
                 }
             }
         }
+        return bound;
+    };
 
-        if (dist_src[u_src] + dist_dest[u_dest] >= minDist) {
+    int pops = 0;
+    int bound = INF;
+    while (!pq.empty()) {
+        int key = pq.top().first;
+        int u = pq.top().second;
+        pq.pop();
+        if (!dirty[u]) {
+            continue;
+        }
+        // re-checking the bound is O(targets), so only do it every so often
+        if (++pops % 256 == 0) {
+            bound = targetBound();
+        }
+        if (key >= bound) {
             break;
         }
+        dirty[u] = false;
+
+        const int* du = &dist[(size_t)u * L];
+        for (auto& neighbor : adjList[u]) {
+            int v = neighbor.first;
+            int w = neighbor.second;
+            int* dv = &dist[(size_t)v * L];
+            int improved = INF;
+#pragma omp simd reduction(min:improved)
+            for (int lane = 0; lane < L; lane++) {
+                int nd = du[lane] + w;
+                int current = dv[lane];
+                int gain = nd < current ? nd : INF;
+                dv[lane] = nd < current ? nd : current;
+                improved = gain < improved ? gain : improved;
+            }
+            if (improved < INF) {
+                dirty[v] = true;
+                pq.push({improved, v});
+            }
+        }
     }
 
-    if (mid == -1) return path;
+    result.assign(count, vector<int>(targets.size(), -1));
+    for (int lane = 0; lane < count; lane++) {
+        for (int j = 0; j < (int)targets.size(); j++) {
+            if (isNode(targets[j]) && dist[(size_t)targets[j] * L + lane] < INF) {
+                result[lane][j] = dist[(size_t)targets[j] * L + lane];
+            }
+        }
+    }
+}
 
-    // build path from src to mid
-    vector<int> pathToMid;
-    int node = mid;
-    while (node != -1) {
-        pathToMid.push_back(node);
-        node = p_src[node];
+// smallest weight / straight line length over all edges
+// the old fixed 0.0001 could overestimate, which made A* return longer paths than dijkstra
+double Graph::computeHeuristicScale(const CoordStore& coords) const {
+    double scale = numeric_limits<double>::infinity();
+    for (int u = 0; u < numVertices; u++) {
+        for (auto& neighbor : adjList[u]) {
+            int v = neighbor.first;
+            double dx = (double)coords.x[u] - coords.x[v];
+            double dy = (double)coords.y[u] - coords.y[v];
+            double length = sqrt(dx * dx + dy * dy);
+            if (length > 0) {
+                scale = min(scale, neighbor.second / length);
+            }
+        }
     }
-    reverse(pathToMid.begin(), pathToMid.end());
+    return scale == numeric_limits<double>::infinity() ? 0 : scale;
+}
 
-    // build path from mid to dest
-    node = p_dest[mid];
-    while (node != -1) {
-        pathToMid.push_back(node);
-        node = p_dest[node];
+CoordStore::CoordStore(const vector<NodeCoord>& nodes, const Graph& graph) {
+    x.resize(nodes.size());
+    y.resize(nodes.size());
+    for (auto& n : nodes) {
+        x[n.id] = n.rawX;
+        y[n.id] = n.rawY;
+    }
+    heuristicScale = graph.computeHeuristicScale(*this);
+}
+
+// sum of the edge weights along path (cheapest edge between each pair)
+// -1 if the path is empty or uses an edge that doesn't exist
+int Graph::pathCost(const vector<int>& path) const {
+    if (path.empty()) {
+        return -1;
+    }
+    int cost = 0;
+    for (int i = 0; i + 1 < (int)path.size(); i++) {
+        if (!isNode(path[i]) || !isNode(path[i + 1])) {
+            return -1;
+        }
+        int best = INT_MAX;
+        for (auto& neighbor : adjList[path[i]]) {
+            if (neighbor.first == path[i + 1]) {
+                best = min(best, neighbor.second);
+            }
+        }
+        if (best == INT_MAX) {
+            return -1;
+        }
+        cost += best;
     }
+    return cost;
+}
 
-    return pathToMid;
+void distanceKernel(const int32_t* x, const int32_t* y, int n, int32_t tx, int32_t ty, float scale, float* out) {
+#pragma omp simd
+    for (int i = 0; i < n; i++) {
+        float dx = (float)(x[i] - tx);
+        float dy = (float)(y[i] - ty);
+        out[i] = sqrt(dx * dx + dy * dy) * scale;
+    }
 }
 
 // A* pathfinding algo
 // its basically dijkstra but it uses a heuristic to make it faster
-vector<int> Graph::aStarPath(int src, int dest, const vector<NodeCoord>& coords) {
+vector<int> Graph::aStarPath(int src, int dest, const CoordStore& coords) {
     vector<int> path;
 
-    // make sure src and dest actually exist
-    if (adjList[src].empty() || adjList[dest].empty()) {
+    // make sure src and dest actually exist and dest isn't in a part src can't get to
+    if (!mayReach(src, dest)) {
         return path;
     }
 
+    // heuristic: straight line distance times the smallest weight per unit of length
+    // of any edge, so it never overestimates and A* returns the same cost as dijkstra
+    // the kernel works in float, shave a bit off the scale so rounding can't overestimate
+    float scale = (float)(coords.heuristicScale * 0.9999);
+
     // need the destination coords for the heuristic
-    double destX = coords[dest].rawX;
-    double destY = coords[dest].rawY;
-
-    // heuristic: just using euclidean distance
-    // straight line distance is always gonna be less than actual path so its fine
-    auto heuristic = [&](int node) -> double {
-        double dx = coords[node].rawX - destX;
-        double dy = coords[node].rawY - destY;
-        // idk why but i had to scale this down alot to make it work right
-        return sqrt(dx * dx + dy * dy) * 0.0001;
-    };
+    int32_t destX = coords.x[dest];
+    int32_t destY = coords.y[dest];
 
     // pq with f score and node id
     // f = g + h where g is dist so far and h is the heuristic
     priority_queue<pair<double, int>, vector<pair<double, int>>, greater<pair<double, int>>> openSet;
 
     // g score is the actual distance from start
-    vector<double> gScore(numVertices, numeric_limits<double>::infinity());
-
-    // f score is g + heuristic
-    vector<double> fScore(numVertices, numeric_limits<double>::infinity());
+    vector<int> gScore(numVertices, INT_MAX);
 
     // for reconstructing the path later
     vector<int> parent(numVertices, -1);
@@ -410,10 +714,15 @@ vector<int> Graph::aStarPath(int src, int dest, const vector<NodeCoord>& coords)
     // keep track of nodes we already looked at
     vector<bool> closedSet(numVertices, false);
 
+    // neighbor coords get copied in here so the heuristic runs over flat arrays
+    vector<int32_t> neighborX, neighborY;
+    vector<float> h;
+
     // setup the starting node
+    float startH;
+    distanceKernel(&coords.x[src], &coords.y[src], 1, destX, destY, scale, &startH);
     gScore[src] = 0;
-    fScore[src] = heuristic(src);
-    openSet.push({fScore[src], src});
+    openSet.push({startH, src});
 
     // main loop
     while (!openSet.empty()) {
@@ -426,39 +735,49 @@ vector<int> Graph::aStarPath(int src, int dest, const vector<NodeCoord>& coords)
             continue;
         }
 
-
         if (current == dest) {
             break;
         }
 
         closedSet[current] = true;
 
+        // heuristic for all the neighbors in one go
+        const vector<pair<int, int>>& neighbors = adjList[current];
+        int degree = neighbors.size();
+        neighborX.resize(degree);
+        neighborY.resize(degree);
+        h.resize(degree);
+        for (int i = 0; i < degree; i++) {
+            neighborX[i] = coords.x[neighbors[i].first];
+            neighborY[i] = coords.y[neighbors[i].first];
+        }
+        distanceKernel(neighborX.data(), neighborY.data(), degree, destX, destY, scale, h.data());
+
         // look at all the neighbors
-        for (auto& neighbor : adjList[current]) {
-            int next = neighbor.first;
-            float edgeWeight = neighbor.second;
+        for (int i = 0; i < degree; i++) {
+            int next = neighbors[i].first;
+            int edgeWeight = neighbors[i].second;
 
             if (closedSet[next]) {
                 continue;
             }
 
             // see if going thru current node is better
-            double tentativeG = gScore[current] + edgeWeight;
+            int tentativeG = gScore[current] + edgeWeight;
 
             // update if its a better path
             if (tentativeG < gScore[next]) {
                 parent[next] = current;
                 gScore[next] = tentativeG;
-                fScore[next] = tentativeG + heuristic(next);
 
-                // add to pq, there might be duplicate...need to test
-                openSet.push({fScore[next], next});
+                // add to pq, old entries for next get skipped by the closed set
+                openSet.push({(double)tentativeG + h[i], next});
             }
         }
     }
 
     // if it doesnt find a path
-    if (gScore[dest] == numeric_limits<double>::infinity()) {
+    if (gScore[dest] == INT_MAX) {
         return path;
     }
 
@@ -473,3 +792,505 @@ vector<int> Graph::aStarPath(int src, int dest, const vector<NodeCoord>& coords)
     reverse(path.begin(), path.end());
     return path;
 }
+
+// recursively cut nodes[begin, end) in half along the wider side at the median,
+// so every cell ends up with about the same number of nodes
+static void splitCells(vector<int>& nodes, int begin, int end, const vector<NodeCoord>& coords,
+                       int depth, int firstCell, vector<int>& cellOf) {
+    if (depth == 0 || end - begin < 2) {
+        for (int i = begin; i < end; i++) {
+            cellOf[nodes[i]] = firstCell;
+        }
+        return;
+    }
+
+    int minX = coords[nodes[begin]].rawX, maxX = minX;
+    int minY = coords[nodes[begin]].rawY, maxY = minY;
+    for (int i = begin; i < end; i++) {
+        minX = min(minX, coords[nodes[i]].rawX);
+        maxX = max(maxX, coords[nodes[i]].rawX);
+        minY = min(minY, coords[nodes[i]].rawY);
+        maxY = max(maxY, coords[nodes[i]].rawY);
+    }
+    bool splitX = (long long)maxX - minX >= (long long)maxY - minY;
+
+    int mid = begin + (end - begin) / 2;
+    nth_element(nodes.begin() + begin, nodes.begin() + mid, nodes.begin() + end, [&](int a, int b) {
+        return splitX ? coords[a].rawX < coords[b].rawX : coords[a].rawY < coords[b].rawY;
+    });
+
+    int half = 1 << (depth - 1);
+    splitCells(nodes, begin, mid, coords, depth - 1, firstCell, cellOf);
+    splitCells(nodes, mid, end, coords, depth - 1, firstCell + half, cellOf);
+}
+
+void Graph::computeArcFlags(const vector<NodeCoord>& coords, int cells) {
+    int depth = 0;
+    while ((1 << depth) < cells && depth < 6) {
+        depth++;
+    }
+    numCells = 1 << depth;
+    if (numCells != cells) {
+        cerr << "Warning: arc flags use a power of 2 cells, up to 64, so " << cells << " cells became " << numCells
+             << endl;
+    }
+
+    // partition
+    cellOf.assign(numVertices, 0);
+    vector<int> nodes(numVertices);
+    for (int i = 0; i < numVertices; i++) {
+        nodes[i] = i;
+    }
+    splitCells(nodes, 0, numVertices, coords, depth, 0, cellOf);
+
+    flagBytes = (numCells + 7) / 8;
+    arcFlags.assign((size_t)firstArc[numVertices] * flagBytes, 0);
+    auto setFlag = [&](int u, int i, int c) {
+        arcFlags[(size_t)(firstArc[u] + i) * flagBytes + c / 8] |= 1 << (c % 8);
+    };
+
+    vector<int> dist(numVertices, INT_MAX);
+    vector<int> touched;
+
+    for (int c = 0; c < numCells; c++) {
+        // arcs inside the cell always keep its flag
+        // boundary nodes are the ones with an arc coming in from another cell
+        vector<int> boundary;
+        for (int v = 0; v < numVertices; v++) {
+            if (cellOf[v] != c) {
+                continue;
+            }
+            bool isBoundary = false;
+            for (auto& in : reverseArcIndex[v]) {
+                if (cellOf[in.first] == c) {
+                    setFlag(in.first, in.second, c);
+                } else {
+                    isBoundary = true;
+                }
+            }
+            if (isBoundary) {
+                boundary.push_back(v);
+            }
+        }
+
+        // backward dijkstra from each boundary node, flag every arc on a shortest path to it
+        for (int b : boundary) {
+            priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> pq;
+            dist[b] = 0;
+            touched.push_back(b);
+            pq.push({0, b});
+
+            while (!pq.empty()) {
+                int d = pq.top().first;
+                int v = pq.top().second;
+                pq.pop();
+                if (d > dist[v]) {
+                    continue;
+                }
+                for (auto& in : reverseArcIndex[v]) {
+                    int u = in.first;
+                    int w = adjList[u][in.second].second;
+                    if (dist[u] > d + w) {
+                        if (dist[u] == INT_MAX) {
+                            touched.push_back(u);
+                        }
+                        dist[u] = d + w;
+                        pq.push({dist[u], u});
+                    }
+                }
+            }
+
+            // keep every tight arc, not just one tree, so ties can't cut off a shortest path
+            for (int u : touched) {
+                for (int i = 0; i < (int)adjList[u].size(); i++) {
+                    int v = adjList[u][i].first;
+                    int w = adjList[u][i].second;
+                    if (dist[v] != INT_MAX && dist[u] == dist[v] + w) {
+                        setFlag(u, i, c);
+                    }
+                }
+            }
+            for (int u : touched) {
+                dist[u] = INT_MAX;
+            }
+            touched.clear();
+        }
+
+        cout << "Arc flags: cell " << c + 1 << "/" << numCells << " (" << boundary.size() << " boundary nodes)" << endl;
+    }
+}
+
+vector<int> Graph::arcFlagDijkstraPath(int src, int dest, bool useFlags) {
+    vector<int> path;
+    if (!mayReach(src, dest)) {
+        return path;
+    }
+    if (arcFlags.empty()) {
+        useFlags = false;
+    }
+    int cell = useFlags ? cellOf[dest] : 0;
+
+    priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> pq;
+    vector<int> dist(numVertices, INT_MAX);
+    vector<int> parent(numVertices, -1);
+
+    pq.push({0, src});
+    dist[src] = 0;
+
+    while (!pq.empty()) {
+        int d = pq.top().first;
+        int u = pq.top().second;
+        pq.pop();
+
+        if (d > dist[u]) {
+            continue;
+        }
+        // dest is settled, nothing left can improve it
+        if (u == dest) {
+            break;
+        }
+
+        for (int i = 0; i < (int)adjList[u].size(); i++) {
+            if (useFlags && !hasArcFlag(u, i, cell)) {
+                continue;
+            }
+            int v = adjList[u][i].first;
+            int w = adjList[u][i].second;
+            if (dist[v] > d + w) {
+                dist[v] = d + w;
+                pq.push({dist[v], v});
+                parent[v] = u;
+            }
+        }
+    }
+
+    if (dist[dest] == INT_MAX) {
+        return path;
+    }
+
+    int node = dest;
+    while (node != -1) {
+        path.push_back(node);
+        node = parent[node];
+    }
+    reverse(path.begin(), path.end());
+    return path;
+}
+
+bool Graph::addWeights(const vector<Edge>& edges) {
+    if (numCriteria() >= MAX_CRITERIA) {
+        cerr << "Error: Graph already has " << MAX_CRITERIA << " weights" << endl;
+        return false;
+    }
+
+    // the graph pushed edges per source in file order, so the i-th edge out of u in
+    // this list has to be adjList[u][i]
+    vector<vector<int>> weights(numVertices);
+    for (int u = 0; u < numVertices; u++) {
+        weights[u].reserve(adjList[u].size());
+    }
+    for (auto& edge : edges) {
+        if (!isNode(edge.src)) {
+            cerr << "Error: Weight file has an edge from unknown node " << edge.src + 1 << endl;
+            return false;
+        }
+        int i = weights[edge.src].size();
+        if (i >= (int)adjList[edge.src].size() || adjList[edge.src][i].first != edge.dest) {
+            cerr << "Error: Weight file edges don't match the graph at " << edge.src + 1 << " -> " << edge.dest + 1 << endl;
+            return false;
+        }
+        weights[edge.src].push_back(edge.weight);
+    }
+    for (int u = 0; u < numVertices; u++) {
+        if (weights[u].size() != adjList[u].size()) {
+            cerr << "Error: Weight file is missing edges out of " << u + 1 << endl;
+            return false;
+        }
+    }
+
+    extraWeights.push_back(move(weights));
+    return true;
+}
+
+bool Graph::loadTurnCosts(const string& filename) {
+    ifstream file(filename);
+    if (!file.is_open()) {
+        cerr << "Error: Could not open turn file: " << filename << endl;
+        return false;
+    }
+
+    int count = 0;
+    string line;
+    while (getline(file, line)) {
+        if (line.empty() || (line[0] != 't' && line[0] != 'x')) {
+            continue;
+        }
+        char type;
+        int from, via, to;
+        istringstream iss(line);
+        iss >> type >> from >> via >> to;
+
+        // 1-indexed in the file like the DIMACS files
+        TurnCost& turn = turnCosts[make_tuple(from - 1, via - 1, to - 1)];
+        if (type == 'x') {
+            turn.forbidden = true;
+        } else {
+            turn.penalty.assign(MAX_CRITERIA, 0);
+            int value;
+            for (int c = 0; c < MAX_CRITERIA && iss >> value; c++) {
+                turn.penalty[c] = value;
+            }
+        }
+        count++;
+    }
+
+    file.close();
+    indexTurnCosts();
+    cout << "Loaded " << count << " turn costs from " << filename << endl;
+    return true;
+}
+
+void Graph::indexTurnCosts() {
+    turnsAfter.assign(firstArc[numVertices], {});
+    for (auto& entry : turnCosts) {
+        int from, via, to;
+        tie(from, via, to) = entry.first;
+        if (!isNode(from) || !isNode(via)) {
+            continue;
+        }
+        // every parallel arc from -> via turning onto every parallel arc via -> to
+        for (auto& in : reverseArcIndex[via]) {
+            if (in.first != from) {
+                continue;
+            }
+            for (int i = 0; i < (int)adjList[via].size(); i++) {
+                if (adjList[via][i].first == to) {
+                    turnsAfter[firstArc[from] + in.second].push_back({firstArc[via] + i, entry.second});
+                }
+            }
+        }
+    }
+    for (auto& turns : turnsAfter) {
+        sort(turns.begin(), turns.end(), [](const pair<int, TurnCost>& a, const pair<int, TurnCost>& b) {
+            return a.first < b.first;
+        });
+    }
+}
+
+// a label is one way of reaching a node with a cost per criterion
+// they all live in one pool and point at the label they came from
+struct Label {
+    int node;
+    int prev;       // index of the previous label in the pool, -1 at src
+    int arc;        // arc id it came in on, -1 at src
+    array<int, MAX_CRITERIA> costs;
+    bool dead;      // dominated after it was queued
+};
+
+// a <= b in every criterion
+static bool weaklyDominates(const array<int, MAX_CRITERIA>& a, const array<int, MAX_CRITERIA>& b, int k) {
+    for (int c = 0; c < k; c++) {
+        if (a[c] > b[c]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+vector<ParetoPath> Graph::multiCriteriaPaths(int src, int dest, const MultiCriteriaOptions& options) {
+    vector<ParetoPath> results;
+    if (!mayReach(src, dest)) {
+        return results;
+    }
+
+    vector<int> criteria = options.criteria;
+    if (criteria.empty()) {
+        for (int c = 0; c < numCriteria(); c++) {
+            criteria.push_back(c);
+        }
+    }
+    int k = criteria.size();
+    for (int c : criteria) {
+        if (c < 0 || c >= numCriteria() || k > MAX_CRITERIA) {
+            cerr << "Error: Unknown criterion " << c << endl;
+            return results;
+        }
+    }
+
+    // lower bound per criterion: backward dijkstra from dest, ignores turn costs (they're never negative)
+    vector<vector<int>> lowerBound(k, vector<int>(numVertices, INT_MAX));
+    for (int j = 0; j < k; j++) {
+        vector<int>& lb = lowerBound[j];
+        priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> pq;
+        lb[dest] = 0;
+        pq.push({0, dest});
+        while (!pq.empty()) {
+            int d = pq.top().first;
+            int v = pq.top().second;
+            pq.pop();
+            if (d > lb[v]) {
+                continue;
+            }
+            for (auto& in : reverseArcIndex[v]) {
+                int u = in.first;
+                int w = arcWeight(criteria[j], u, in.second);
+                if (lb[u] > d + w) {
+                    lb[u] = d + w;
+                    pq.push({lb[u], u});
+                }
+            }
+        }
+    }
+    if (lowerBound[0][src] == INT_MAX) {
+        return results;
+    }
+
+    // with turn costs what a label can do next depends on where it came from,
+    // so labels only compete with labels that came in over the same arc: one bag per arc
+    // and one more for the start, instead of one per node
+    bool turnAware = !turnsAfter.empty();
+    int numArcs = firstArc[numVertices];
+    vector<vector<int>> bags(turnAware ? numArcs + 1 : numVertices);
+    auto bagOf = [&](const Label& label) -> vector<int>& {
+        if (!turnAware) {
+            return bags[label.node];
+        }
+        return bags[label.arc == -1 ? numArcs : label.arc];
+    };
+
+    vector<Label> pool;
+    pool.reserve(1 << 16);
+    vector<array<int, MAX_CRITERIA>> targetCosts;
+
+    // queue is ordered by cost + lower bound, lexicographically in criteria order
+    typedef pair<array<int, MAX_CRITERIA>, int> QueueEntry;
+    priority_queue<QueueEntry, vector<QueueEntry>, greater<QueueEntry>> pq;
+
+    Label start = {src, -1, -1, {}, false};
+    pool.push_back(start);
+    bagOf(start).push_back(0);
+    array<int, MAX_CRITERIA> startKey = {};
+    for (int j = 0; j < k; j++) {
+        startKey[j] = lowerBound[j][src];
+    }
+    pq.push({startKey, 0});
+
+    while (!pq.empty()) {
+        array<int, MAX_CRITERIA> popped = pq.top().first;
+        int index = pq.top().second;
+        pq.pop();
+        if (pool[index].dead) {
+            continue;
+        }
+        Label label = pool[index];
+
+        // a path to dest found after this label was pushed can dominate it by now, with turn costs
+        // the labels at dest are in different bags (one per incoming edge) so this is the only check between them
+        bool dominated = false;
+        for (auto& target : targetCosts) {
+            if (weaklyDominates(target, popped, k)) {
+                dominated = true;
+                break;
+            }
+        }
+        if (dominated) {
+            continue;
+        }
+
+        // nothing found so far dominates it and the rest come out lexicographically after it
+        if (label.node == dest) {
+            targetCosts.push_back(label.costs);
+            ParetoPath result;
+            result.costs.assign(label.costs.begin(), label.costs.begin() + k);
+            for (int l = index; l != -1; l = pool[l].prev) {
+                result.path.push_back(pool[l].node);
+            }
+            reverse(result.path.begin(), result.path.end());
+            results.push_back(result);
+            if (!options.paretoFront) {
+                break;
+            }
+            continue;
+        }
+
+        int u = label.node;
+        // the turns out of the arc this label came in on, sorted like the arcs out of u
+        // so one pointer walks them alongside the loop
+        const vector<pair<int, TurnCost>>* turns = turnAware && label.arc != -1 ? &turnsAfter[label.arc] : nullptr;
+        size_t nextTurn = 0;
+        for (int i = 0; i < (int)adjList[u].size(); i++) {
+            int v = adjList[u][i].first;
+            if (lowerBound[0][v] == INT_MAX) {
+                continue;
+            }
+
+            int arc = firstArc[u] + i;
+            Label next = {v, index, arc, label.costs, false};
+            for (int j = 0; j < k; j++) {
+                next.costs[j] += arcWeight(criteria[j], u, i);
+            }
+            if (turns) {
+                while (nextTurn < turns->size() && (*turns)[nextTurn].first < arc) {
+                    nextTurn++;
+                }
+                if (nextTurn < turns->size() && (*turns)[nextTurn].first == arc) {
+                    const TurnCost& turn = (*turns)[nextTurn].second;
+                    if (turn.forbidden) {
+                        continue;
+                    }
+                    for (int j = 0; j < k; j++) {
+                        next.costs[j] += turn.penalty[criteria[j]];
+                    }
+                }
+            }
+
+            // skip it if something that already reached dest is at least as good as its best case
+            array<int, MAX_CRITERIA> key = next.costs;
+            for (int j = 0; j < k; j++) {
+                key[j] += lowerBound[j][v];
+            }
+            bool pruned = false;
+            for (auto& target : targetCosts) {
+                if (weaklyDominates(target, key, k)) {
+                    pruned = true;
+                    break;
+                }
+            }
+            if (pruned) {
+                continue;
+            }
+
+            // dominance check against the labels already at v
+            // the lexicographic search only needs the single best label per bag
+            vector<int>& bag = bagOf(next);
+            for (int other : bag) {
+                if (options.paretoFront ? weaklyDominates(pool[other].costs, next.costs, k)
+                                        : pool[other].costs <= next.costs) {
+                    pruned = true;
+                    break;
+                }
+            }
+            if (pruned) {
+                continue;
+            }
+            for (int b = 0; b < (int)bag.size();) {
+                if (!options.paretoFront || weaklyDominates(next.costs, pool[bag[b]].costs, k)) {
+                    pool[bag[b]].dead = true;
+                    bag[b] = bag.back();
+                    bag.pop_back();
+                } else {
+                    b++;
+                }
+            }
+            if (options.maxLabelsPerNode > 0 && (int)bag.size() >= options.maxLabelsPerNode) {
+                continue;
+            }
+
+            bag.push_back(pool.size());
+            pool.push_back(next);
+            pq.push({key, (int)pool.size() - 1});
+        }
+    }
+
+    return results;
+}
@@ -4,12 +4,15 @@
 #include <functional>
 #include <queue>
 #include <map>
+#include <tuple>
+#include <array>
 #include <utility>
 #include <vector>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <cmath>
+#include <cstdint>
 #include <SFML/Graphics.hpp>
 using namespace std;
 
@@ -18,39 +21,129 @@ using namespace std;
 
 struct Edge {
     int src, dest, weight;
-    Edge(int _src, int _dest, float _weight) {src = _src; dest = _dest; weight = _weight;}
+    Edge(int _src, int _dest, int _weight) {src = _src; dest = _dest; weight = _weight;}
 };
 
 // Struct to hold coordinate data from .co file
+// DIMACS coordinates are integer microdegrees so 32 bits is enough
 struct NodeCoord {
     int id;
-    double x, y;  // Normalized coordinates for display
-    double rawX, rawY;  // Original coordinates from file
+    int rawX, rawY;  // Original coordinates from file
 };
 
+class Graph;
+
+// Coordinates as two flat arrays indexed by node id (structure of arrays).
+// A* only needs x and y, so this keeps 8 bytes per node next to each other
+// instead of pulling in a whole NodeCoord for every heuristic call.
+// Built for one graph, the A* heuristic scale for that graph is worked out here once.
+struct CoordStore {
+    vector<int32_t> x, y;
+    double heuristicScale = 0;    // min(weight / straight line length) over the graph's edges
+
+    CoordStore(const vector<NodeCoord>& nodes, const Graph& graph);
+};
+
+// out[i] = straight line distance from (x[i], y[i]) to (tx, ty) times scale
+// plain loop over flat arrays with no branches so the compiler can vectorize it
+void distanceKernel(const int32_t* x, const int32_t* y, int n, int32_t tx, int32_t ty, float scale, float* out);
+
+// searches run side by side by multiSourceDistances, one distance per lane
+const int SEARCH_LANES = 8;
+
+// most weights a graph can carry (distance, travel time, ...)
+const int MAX_CRITERIA = 4;
+
+// penalty for turning from -> via -> to, one value per criterion
+struct TurnCost {
+    bool forbidden = false;
+    vector<int> penalty;
+};
+
+// one result of a multi criteria query, costs are in the order of MultiCriteriaOptions::criteria
+struct ParetoPath {
+    vector<int> costs;
+    vector<int> path;
+};
+
+struct MultiCriteriaOptions {
+    vector<int> criteria;        // which weights to use, most important first (empty = all of them)
+    bool paretoFront = true;     // false: just the lexicographically best path (e.g. time, then distance)
+    int maxLabelsPerNode = 32;   // caps the labels kept at a node to stay fast, 0 = exact front
+};
+
+// strongly and weakly connected components of a graph in CSR form, the arcs of u go to
+// targets[offsets[u]] .. targets[offsets[u + 1] - 1]
+// scc ids come out of tarjan in reverse topological order: anything reachable
+// from a component has a smaller or equal id
+struct Components {
+    vector<int> sccOf;
+    vector<int> wccOf;
+    int numSCCs = 0;
+    int numWCCs = 0;
+    int largestSCC = -1;
+    int largestSCCSize = 0;
+};
+// arcHead(v, i) is the head of the i-th arc out of v, or -1 once i is past the last one,
+// so the arcs can come from anywhere (adjList, tiles paged in from disk)
+Components findComponents(int n, const function<int(int, int)>& arcHead);
+
 // DIMACS file loader results
 struct DIMACSData {
     vector<NodeCoord> nodes;
     vector<Edge> edges;
     int numNodes;
     int numEdges;
-    double minX, maxX, minY, maxY;  // Bounding box of original coordinates
+    int minX, maxX, minY, maxY;  // Bounding box of original coordinates
 };
 
 class Graph {
 public:
     int numVertices;
-    vector<vector<pair<float, float>>> adjList;
+    vector<vector<pair<int, int>>> adjList;  // (neighbor, weight)
+    // (tail, index in adjList[tail]) for every edge into a node, for the backward searches
+    // the weight, any other criterion or flag of the edge is read through adjList
+    vector<vector<pair<int, int>>> reverseArcIndex;
+    // adjList[u][i] is arc firstArc[u] + i, anything kept per arc is indexed by that
+    vector<int> firstArc;
 
     Graph(const vector<Edge>& edges, int vertices) {
         numVertices = vertices;
 
         adjList.resize(vertices);
+        reverseArcIndex.resize(vertices);
 
         for (auto &edge : edges) {
+            reverseArcIndex[edge.dest].push_back(make_pair(edge.src, (int)adjList[edge.src].size()));
             adjList[edge.src].push_back(make_pair(edge.dest, edge.weight));
         }
+        firstArc.assign(vertices + 1, 0);
+        for (int u = 0; u < vertices; u++) {
+            firstArc[u + 1] = firstArc[u] + adjList[u].size();
+        }
+
+        computeComponents();
+    }
+
+    bool isNode(int v) const { return v >= 0 && v < numVertices; }
+
+    // component index, built when the graph is loaded (see findComponents)
+    vector<int> sccOf;
+    vector<int> wccOf;     // weakly connected (edge direction ignored)
+    int numSCCs = 0;
+    int numWCCs = 0;
+    int largestSCC = -1;
+    int largestSCCSize = 0;
+    void computeComponents();
+
+    // O(1) check, false means there is definitely no path from src to dest
+    // true only means the search has to find out
+    bool mayReach(int src, int dest) const {
+        return isNode(src) && isNode(dest) &&
+               (src == dest || (wccOf[src] == wccOf[dest] && sccOf[src] >= sccOf[dest]));
     }
+    // only the edges with both ends in the largest scc, node ids stay the same
+    vector<Edge> largestSCCEdges() const;
     int dijkstra(int src, int dest, vector<sf::VertexArray>& lines, map<pair<int, int>, int>& lineMapper);
     int two_way_dijkstra(int src, int dest, vector<sf::VertexArray>& lines,map<pair<int, int>, int>& lineMapper);
 
@@ -58,13 +151,70 @@ public:
     vector<int> dijkstraPath(int src, int dest);
     vector<int> twoWayDijkstraPath(int src, int dest);
 
-    // A* algorithm, needs coordinates for the heuristic
-    vector<int> aStarPath(int src, int dest, const vector<NodeCoord>& coords);
+    // A* algorithm, needs coordinates for the heuristic (a CoordStore built for this graph)
+    vector<int> aStarPath(int src, int dest, const CoordStore& coords);
+    double computeHeuristicScale(const CoordStore& coords) const;
+
+    // one search from src that stops once all targets are settled
+    // returns the distance to each target, -1 if it can't be reached
+    vector<int> dijkstraToMany(int src, const vector<int>& targets);
+    // SEARCH_LANES searches at a time that share every adjacency scan, works best when the
+    // sources are close together (like depots in one area)
+    // result[i][j] is the distance from sources[i] to targets[j] (-1 if unreachable)
+    vector<vector<int>> multiSourceDistances(const vector<int>& sources, const vector<int>& targets);
+
+    // total weight of a path, -1 if it isn't a valid path
+    int pathCost(const vector<int>& path) const;
+
+    // arc flags in one flat array by arc id (see firstArc), each arc owns flagBytes bytes
+    // and bit c is set if the arc is on a shortest path into cell c
+    int numCells = 0;
+    int flagBytes = 0;
+    vector<int> cellOf;
+    vector<uint8_t> arcFlags;
+    bool hasArcFlag(int u, int i, int c) const {
+        return arcFlags[(size_t)(firstArc[u] + i) * flagBytes + c / 8] & (1 << (c % 8));
+    }
+
+    // splits the graph into cells (power of 2, up to 64) and computes the arc flags
+    // other cell counts are rounded up (or down to 64) with a warning, numCells has the one used
+    void computeArcFlags(const vector<NodeCoord>& coords, int cells);
+    // dijkstra that only follows arcs flagged for the cell of dest and stops once dest is settled
+    // useFlags = false runs the same search without pruning, to measure the flags on their own
+    vector<int> arcFlagDijkstraPath(int src, int dest, bool useFlags = true);
+
+    // extra weights per edge, extraWeights[k][u][i] is criterion k+1 of adjList[u][i]
+    // criterion 0 is the weight already in adjList
+    vector<vector<vector<int>>> extraWeights;
+    int numCriteria() const { return 1 + extraWeights.size(); }
+    int arcWeight(int c, int u, int i) const { return c == 0 ? adjList[u][i].second : extraWeights[c - 1][u][i]; }
+
+    // adds a weight vector (like travel times from USA-road-t.NY.gr), the edges have to be
+    // the same ones in the same order the graph was built from, returns false if they aren't
+    bool addWeights(const vector<Edge>& edges);
+
+    // turn restrictions and penalties, key is (from, via, to)
+    map<tuple<int, int, int>, TurnCost> turnCosts;
+    // the same turns by arc id for the search, turnsAfter[a] is (next arc, cost) for every turn
+    // from arc a onto an arc out of its head, sorted by the next arc (empty without turn costs)
+    vector<vector<pair<int, TurnCost>>> turnsAfter;
+    // lines "t <from> <via> <to> <penalty per criterion...>" or "x <from> <via> <to>" to forbid a turn
+    bool loadTurnCosts(const string& filename);
+
+    // label setting search over several criteria with dominance pruning
+    vector<ParetoPath> multiCriteriaPaths(int src, int dest, const MultiCriteriaOptions& options);
 
     // Static methods to load DIMACS files
+    // loadDIMACS returns the nodes sorted by id, so nodes[i] is node i
     static DIMACSData loadDIMACS(const string& coFile, const string& grFile);
     static vector<NodeCoord> loadCoordinates(const string& filename);
     static vector<Edge> loadEdges(const string& filename, int& numNodes, int& numEdges);
+
+private:
+    int twoWaySearch(int src, int dest, vector<int>& p_src, vector<int>& p_dest, int& mid);
+    void laneSearch(const int* sources, int count, const vector<int>& targets, vector<vector<int>>& result);
+    // fills turnsAfter from turnCosts
+    void indexTurnCosts();
 };
 
 
@@ -0,0 +1,514 @@
+#include "SelfCheck.h"
+#include "TiledGraph.h"
+#include <iostream>
+#include <filesystem>
+#include <random>
+#include <chrono>
+#include <climits>
+#include <algorithm>
+using namespace std;
+
+// one search algorithm, returns the path cost or -1 for no path
+struct CheckAlgorithm {
+    string name;
+    function<int(int, int)> run;
+    double baselineRatio = 0;    // recorded time per query over plain dijkstra's, 0 = not timed
+    double totalMs = 0;
+    int queries = 0;
+    int mismatches = 0;
+};
+
+static void writeDIMACS(const string& coFile, const string& grFile, const DIMACSData& data) {
+    ofstream co(coFile);
+    co << "p aux sp co " << data.nodes.size() << "\n";
+    for (auto& n : data.nodes) {
+        co << "v " << n.id + 1 << " " << n.rawX << " " << n.rawY << "\n";
+    }
+    ofstream gr(grFile);
+    gr << "p sp " << data.numNodes << " " << data.edges.size() << "\n";
+    for (auto& e : data.edges) {
+        gr << "a " << e.src + 1 << " " << e.dest + 1 << " " << e.weight << "\n";
+    }
+}
+
+// grid graphs side x side, one per component, placed next to each other
+// oneWay turns about half the streets into one-way streets
+// one extra node at the end has no edges at all
+static DIMACSData syntheticGraph(int side, int components, bool oneWay, mt19937& rng) {
+    DIMACSData data;
+    uniform_int_distribution<int> jitter(0, 300);
+    uniform_int_distribution<int> extra(0, 40);
+    uniform_int_distribution<int> direction(0, 3);
+
+    int perComponent = side * side;
+    for (int c = 0; c < components; c++) {
+        for (int i = 0; i < perComponent; i++) {
+            NodeCoord node;
+            node.id = c * perComponent + i;
+            node.rawX = -74000000 + (c * (side + 2) + i % side) * 1000 + jitter(rng);
+            node.rawY = 40000000 + (i / side) * 1000 + jitter(rng);
+            data.nodes.push_back(node);
+        }
+    }
+    NodeCoord isolated;
+    isolated.id = data.nodes.size();
+    isolated.rawX = -74000000;
+    isolated.rawY = 39990000;
+    data.nodes.push_back(isolated);
+
+    for (int c = 0; c < components; c++) {
+        for (int i = 0; i < perComponent; i++) {
+            int u = c * perComponent + i;
+            for (int j : {i + 1, i + side}) {
+                if ((j == i + 1 && j % side == 0) || j >= perComponent) {
+                    continue;
+                }
+                int v = c * perComponent + j;
+                double dx = data.nodes[u].rawX - data.nodes[v].rawX;
+                double dy = data.nodes[u].rawY - data.nodes[v].rawY;
+                int weight = (int)sqrt(dx * dx + dy * dy) / 10 + extra(rng) + 1;
+
+                int dir = oneWay ? direction(rng) : 0;
+                if (dir != 2) {
+                    data.edges.emplace_back(u, v, weight);
+                }
+                if (dir != 3) {
+                    data.edges.emplace_back(v, u, weight);
+                }
+            }
+        }
+    }
+    data.numNodes = data.nodes.size();
+    data.numEdges = data.edges.size();
+    return data;
+}
+
+// the middle of a map (fraction of its width and height), renumbered to 0..n-1
+static DIMACSData middleOfMap(const string& coFile, const string& grFile, double fraction) {
+    DIMACSData full = Graph::loadDIMACS(coFile, grFile);
+    DIMACSData data;
+    if (full.nodes.empty() || full.edges.empty()) {
+        return data;
+    }
+
+    double minX = full.minX + (full.maxX - full.minX) * (0.5 - fraction / 2);
+    double maxX = full.minX + (full.maxX - full.minX) * (0.5 + fraction / 2);
+    double minY = full.minY + (full.maxY - full.minY) * (0.5 - fraction / 2);
+    double maxY = full.minY + (full.maxY - full.minY) * (0.5 + fraction / 2);
+
+    vector<int> newId(full.numNodes, -1);
+    for (auto& n : full.nodes) {
+        if (n.rawX >= minX && n.rawX <= maxX && n.rawY >= minY && n.rawY <= maxY) {
+            newId[n.id] = data.nodes.size();
+            NodeCoord node = n;
+            node.id = newId[n.id];
+            data.nodes.push_back(node);
+        }
+    }
+    for (auto& e : full.edges) {
+        if (newId[e.src] != -1 && newId[e.dest] != -1) {
+            data.edges.emplace_back(newId[e.src], newId[e.dest], e.weight);
+        }
+    }
+    data.numNodes = data.nodes.size();
+    data.numEdges = data.edges.size();
+    return data;
+}
+
+bool extractSubset(const string& coFile, const string& grFile, const string& outCo, const string& outGr,
+                   double fraction) {
+    DIMACSData data = middleOfMap(coFile, grFile, fraction);
+    if (data.numNodes < 2) {
+        cerr << "Error: no subset to write, check the map files" << endl;
+        return false;
+    }
+    writeDIMACS(outCo, outGr, data);
+    cout << "Wrote " << data.numNodes << " nodes and " << data.edges.size() << " edges to " << outCo << " / "
+         << outGr << endl;
+    return true;
+}
+
+// plain BFS, doesn't use anything from the component index
+static bool reachableBFS(const Graph& graph, int src, int dest) {
+    vector<bool> seen(graph.numVertices, false);
+    vector<int> queue = {src};
+    seen[src] = true;
+    for (int i = 0; i < (int)queue.size(); i++) {
+        if (queue[i] == dest) {
+            return true;
+        }
+        for (auto& neighbor : graph.adjList[queue[i]]) {
+            if (!seen[neighbor.first]) {
+                seen[neighbor.first] = true;
+                queue.push_back(neighbor.first);
+            }
+        }
+    }
+    return false;
+}
+
+// runs all algorithms on one graph, returns false on any mismatch
+// dir is a scratch directory only this run uses
+static bool checkGraph(const string& name, const DIMACSData& generated, int pairs, mt19937& rng,
+                       vector<CheckAlgorithm>& totals, const string& dir) {
+    cout << "\n----- " << name << " -----" << endl;
+
+    // go through the real loaders so parsing gets checked too
+    string coFile = dir + "/graph.co";
+    string grFile = dir + "/graph.gr";
+    writeDIMACS(coFile, grFile, generated);
+
+    DIMACSData data = Graph::loadDIMACS(coFile, grFile);
+    if ((int)data.nodes.size() != generated.numNodes || data.edges.size() != generated.edges.size()) {
+        cout << "FAIL: loader read " << data.nodes.size() << " nodes / " << data.edges.size() << " edges" << endl;
+        return false;
+    }
+
+    Graph graph(data.edges, data.numNodes);
+    CoordStore coords(data.nodes, graph);
+    graph.computeArcFlags(data.nodes, 8);
+
+    // made up travel times so the multi criteria search has two weights to trade off
+    vector<Edge> times;
+    for (auto& e : data.edges) {
+        times.emplace_back(e.src, e.dest, e.weight * (1 + (e.src + e.dest) % 3));
+    }
+    if (!graph.addWeights(times)) {
+        cout << "FAIL: could not add a second weight" << endl;
+        return false;
+    }
+    MultiCriteriaOptions lexicographic;
+    lexicographic.criteria = {0, 1};
+    lexicographic.paretoFront = false;
+    MultiCriteriaOptions exactFront;
+    exactFront.criteria = {1, 0};
+    exactFront.maxLabelsPerNode = 0;
+
+    // distance of the lexicographic (distance, time) path, or the shortest distance on the whole front
+    auto multiCriteria = [&](int s, int d, const MultiCriteriaOptions& options, int distanceIndex) {
+        int best = -1;
+        for (auto& result : graph.multiCriteriaPaths(s, d, options)) {
+            if (graph.pathCost(result.path) != result.costs[distanceIndex]) {
+                return -2;
+            }
+            if (best == -1 || result.costs[distanceIndex] < best) {
+                best = result.costs[distanceIndex];
+            }
+        }
+        return best;
+    };
+
+    // small enough budget that tiles and their search state get evicted and paged back in
+    TiledGraph tiled;
+    if (!TiledGraph::build(coFile, grFile, dir + "/tiles", 8) || !tiled.open(dir + "/tiles", 32 * 1024)) {
+        cout << "FAIL: could not build tiles" << endl;
+        return false;
+    }
+
+    // the drawing versions print "No path found", keep that out of the report
+    vector<sf::VertexArray> lines;
+    map<pair<int, int>, int> lineMapper;
+    auto quiet = [](const function<int()>& f) {
+        streambuf* old = cout.rdbuf(nullptr);
+        int result = f();
+        cout.rdbuf(old);
+        return result;
+    };
+
+    // the last number is the time per query over plain dijkstra's, recorded on these graphs
+    // tiled A* is slow here because the tiny budget makes it write search state to disk
+    vector<CheckAlgorithm> algorithms = {
+        {"Dijkstra (draw)", [&](int s, int d) { return quiet([&] { return graph.dijkstra(s, d, lines, lineMapper); }); }, 1.0},
+        {"Two-way (draw)", [&](int s, int d) { return quiet([&] { return graph.two_way_dijkstra(s, d, lines, lineMapper); }); }, 0.41},
+        {"Two-way Dijkstra", [&](int s, int d) { return graph.pathCost(graph.twoWayDijkstraPath(s, d)); }, 0.30},
+        {"A*", [&](int s, int d) { return graph.pathCost(graph.aStarPath(s, d, coords)); }, 0.40},
+        {"Arc flags", [&](int s, int d) { return graph.pathCost(graph.arcFlagDijkstraPath(s, d)); }, 0.17},
+        {"Tiled A*", [&](int s, int d) { int dist; tiled.aStarPath(s, d, dist); return dist; }, 2.1},
+        {"Multi-criteria (lexicographic)", [&](int s, int d) { return multiCriteria(s, d, lexicographic, 0); }, 2.5},
+        {"Pareto front", [&](int s, int d) { return multiCriteria(s, d, exactFront, 1); }, 3.0},
+        {"One-to-many", [&](int s, int d) { return graph.dijkstraToMany(s, {d})[0]; }, 0.56},
+    };
+    CheckAlgorithm reference = {"Dijkstra", [&](int s, int d) { return graph.pathCost(graph.dijkstraPath(s, d)); }};
+
+    // same node and the isolated node first, then random pairs
+    int last = data.numNodes - 1;
+    vector<pair<int, int>> queries = {{0, 0}, {last, last}, {0, last}, {last, 0}};
+    uniform_int_distribution<int> pick(0, data.numNodes - 1);
+    while ((int)queries.size() < pairs) {
+        queries.push_back({pick(rng), pick(rng)});
+    }
+
+    auto timed = [](CheckAlgorithm& algorithm, int s, int d) {
+        auto start = chrono::high_resolution_clock::now();
+        int cost = algorithm.run(s, d);
+        auto end = chrono::high_resolution_clock::now();
+        algorithm.totalMs += chrono::duration<double, milli>(end - start).count();
+        algorithm.queries++;
+        return cost;
+    };
+
+    bool ok = true;
+    int unreachable = 0;
+    for (auto& q : queries) {
+        int expected = timed(reference, q.first, q.second);
+        if (expected == -1) {
+            unreachable++;
+        }
+        for (auto& algorithm : algorithms) {
+            int cost = timed(algorithm, q.first, q.second);
+            if (cost != expected) {
+                if (algorithm.mismatches < 5) {
+                    cout << "MISMATCH " << algorithm.name << " " << q.first << " -> " << q.second
+                         << ": got " << cost << ", dijkstra says " << expected << endl;
+                }
+                algorithm.mismatches++;
+                ok = false;
+            }
+        }
+    }
+
+    // one lane batch and a partial one, against plain dijkstra
+    CheckAlgorithm lanes = {"Multi-source lanes", nullptr, 0.075};
+    vector<int> sources, targets;
+    for (int i = 0; i < SEARCH_LANES + 3; i++) {
+        sources.push_back(pick(rng));
+    }
+    targets.push_back(last);
+    for (int j = 0; j < 20; j++) {
+        targets.push_back(pick(rng));
+    }
+    auto start = chrono::high_resolution_clock::now();
+    vector<vector<int>> matrix = graph.multiSourceDistances(sources, targets);
+    auto end = chrono::high_resolution_clock::now();
+    lanes.totalMs = chrono::duration<double, milli>(end - start).count();
+    lanes.queries = sources.size() * targets.size();
+    for (int i = 0; i < (int)sources.size(); i++) {
+        for (int j = 0; j < (int)targets.size(); j++) {
+            int expected = graph.pathCost(graph.dijkstraPath(sources[i], targets[j]));
+            if (matrix[i][j] != expected) {
+                if (lanes.mismatches < 5) {
+                    cout << "MISMATCH " << lanes.name << " " << sources[i] << " -> " << targets[j]
+                         << ": got " << matrix[i][j] << ", dijkstra says " << expected << endl;
+                }
+                lanes.mismatches++;
+                ok = false;
+            }
+        }
+    }
+    algorithms.push_back(lanes);
+
+    // every search trusts the component index, so check it on its own: it may never rule out a
+    // pair BFS can connect, and any two nodes in the largest scc have to be connected
+    CheckAlgorithm components = {"Component index", nullptr, 8e-5};
+    Graph largest(graph.largestSCCEdges(), graph.numVertices);
+    int rejected = 0;
+    start = chrono::high_resolution_clock::now();
+    for (auto& q : queries) {
+        rejected += !graph.mayReach(q.first, q.second);
+    }
+    end = chrono::high_resolution_clock::now();
+    components.totalMs = chrono::duration<double, milli>(end - start).count();
+    components.queries = queries.size();
+    for (int i = 0; i < (int)queries.size() && i < 200; i++) {
+        int s = queries[i].first;
+        int d = queries[i].second;
+        bool inLargest = graph.sccOf[s] == graph.largestSCC && graph.sccOf[d] == graph.largestSCC;
+        if ((reachableBFS(graph, s, d) && !graph.mayReach(s, d)) ||
+            (inLargest && largest.pathCost(largest.dijkstraPath(s, d)) == -1)) {
+            if (components.mismatches < 5) {
+                cout << "MISMATCH " << components.name << " " << s << " -> " << d << endl;
+            }
+            components.mismatches++;
+            ok = false;
+        }
+    }
+    algorithms.push_back(components);
+    cout << rejected << " pairs ruled out by the component index" << endl;
+
+    // turn costs: dijkstra can't check these directly, so build the edge based graph (one node per
+    // edge, turns become the edges between them) and run plain dijkstra on it once per criterion
+    CheckAlgorithm turnFront = {"Pareto front with turns", nullptr, 6.7};
+    string turnFile = dir + "/turns.txt";
+    {
+        ofstream turnsOut(turnFile);
+        uniform_int_distribution<int> kind(0, 9);
+        uniform_int_distribution<int> penalty(0, 300);
+        for (auto& in : data.edges) {
+            for (auto& out : graph.adjList[in.dest]) {
+                int k = kind(rng);
+                if (k == 0) {
+                    turnsOut << "x " << in.src + 1 << " " << in.dest + 1 << " " << out.first + 1 << "\n";
+                } else if (k <= 2) {
+                    turnsOut << "t " << in.src + 1 << " " << in.dest + 1 << " " << out.first + 1 << " "
+                             << penalty(rng) << " " << penalty(rng) << "\n";
+                }
+            }
+        }
+    }
+    Graph turnGraph(data.edges, data.numNodes);
+    if (!turnGraph.addWeights(times) || !quiet([&] { return (int)turnGraph.loadTurnCosts(turnFile); })) {
+        cout << "FAIL: could not load the turn costs" << endl;
+        return false;
+    }
+
+    // nodes: edge i is i, "arrived at v" is m + v, "start at v" is m + n + v
+    int m = data.edges.size();
+    int n = data.numNodes;
+    vector<vector<int>> edgesOut(n);
+    for (int i = 0; i < m; i++) {
+        edgesOut[data.edges[i].src].push_back(i);
+    }
+    vector<Graph> edgeBased;
+    for (int criterion = 0; criterion < 2; criterion++) {
+        auto weight = [&](int i) { return criterion == 0 ? data.edges[i].weight : times[i].weight; };
+        vector<Edge> expanded;
+        for (int v = 0; v < n; v++) {
+            expanded.emplace_back(m + n + v, m + v, 0);
+            for (int i : edgesOut[v]) {
+                expanded.emplace_back(m + n + v, i, weight(i));
+            }
+        }
+        for (int i = 0; i < m; i++) {
+            int u = data.edges[i].src;
+            int v = data.edges[i].dest;
+            expanded.emplace_back(i, m + v, 0);
+            for (int j : edgesOut[v]) {
+                int extra = 0;
+                auto turn = turnGraph.turnCosts.find(make_tuple(u, v, data.edges[j].dest));
+                if (turn != turnGraph.turnCosts.end()) {
+                    if (turn->second.forbidden) {
+                        continue;
+                    }
+                    extra = turn->second.penalty[criterion];
+                }
+                expanded.emplace_back(i, j, weight(j) + extra);
+            }
+        }
+        quiet([&] {
+            edgeBased.emplace_back(expanded, m + 2 * n);
+            return 0;
+        });
+    }
+
+    MultiCriteriaOptions fastestWithTurns;
+    fastestWithTurns.criteria = {1, 0};
+    fastestWithTurns.paretoFront = false;
+    for (int i = 0; i < (int)queries.size() && i < 200; i++) {
+        int s = queries[i].first;
+        int d = queries[i].second;
+        int bestDistance = edgeBased[0].pathCost(edgeBased[0].dijkstraPath(m + n + s, m + d));
+        int bestTime = edgeBased[1].pathCost(edgeBased[1].dijkstraPath(m + n + s, m + d));
+
+        start = chrono::high_resolution_clock::now();
+        vector<ParetoPath> front = turnGraph.multiCriteriaPaths(s, d, exactFront);
+        end = chrono::high_resolution_clock::now();
+        turnFront.totalMs += chrono::duration<double, milli>(end - start).count();
+        turnFront.queries++;
+        vector<ParetoPath> fastest = turnGraph.multiCriteriaPaths(s, d, fastestWithTurns);
+
+        // the front has to hold the fastest and the shortest path, nothing on it may dominate
+        // anything else on it, and its lexicographically first entry is the fastest path
+        bool good = front.empty() ? bestTime == -1 && fastest.empty() : !fastest.empty();
+        if (good && !front.empty()) {
+            int minTime = INT_MAX, minDistance = INT_MAX;
+            for (auto& a : front) {
+                minTime = min(minTime, a.costs[0]);
+                minDistance = min(minDistance, a.costs[1]);
+                for (auto& b : front) {
+                    if (&a != &b && a.costs[0] <= b.costs[0] && a.costs[1] <= b.costs[1]) {
+                        good = false;
+                    }
+                }
+            }
+            good = good && minTime == bestTime && minDistance == bestDistance &&
+                   fastest[0].costs == min_element(front.begin(), front.end(), [](const ParetoPath& a, const ParetoPath& b) {
+                       return a.costs < b.costs;
+                   })->costs;
+        }
+        if (!good) {
+            if (turnFront.mismatches < 5) {
+                cout << "MISMATCH " << turnFront.name << " " << s << " -> " << d << ": edge based dijkstra says time "
+                     << bestTime << ", distance " << bestDistance << endl;
+            }
+            turnFront.mismatches++;
+            ok = false;
+        }
+    }
+    algorithms.push_back(turnFront);
+
+    cout << queries.size() << " pairs, " << unreachable << " without a path" << endl;
+    algorithms.insert(algorithms.begin(), reference);
+    for (auto& algorithm : algorithms) {
+        auto it = find_if(totals.begin(), totals.end(), [&](const CheckAlgorithm& t) { return t.name == algorithm.name; });
+        if (it == totals.end()) {
+            totals.push_back({algorithm.name, nullptr, algorithm.baselineRatio});
+            it = totals.end() - 1;
+        }
+        it->totalMs += algorithm.totalMs;
+        it->queries += algorithm.queries;
+        it->mismatches += algorithm.mismatches;
+    }
+    return ok;
+}
+
+int runSelfCheck(const string& subsetCo, const string& subsetGr, int pairs, double tolerance) {
+    mt19937 rng(12345);
+    vector<CheckAlgorithm> totals;
+    bool ok = true;
+
+    // scratch files go in a directory of their own, so runs at the same time can't touch each other's files
+    string dir;
+    random_device seed;
+    for (int attempt = 0; dir.empty() && attempt < 100; attempt++) {
+        string candidate = (filesystem::temp_directory_path() / ("project3_selfcheck_" + to_string(seed()))).string();
+        if (filesystem::create_directory(candidate)) {
+            dir = candidate;
+        }
+    }
+    if (dir.empty()) {
+        cerr << "Error: Could not create a scratch directory in " << filesystem::temp_directory_path() << endl;
+        return 1;
+    }
+
+    ok &= checkGraph("grid", syntheticGraph(30, 1, false, rng), pairs, rng, totals, dir);
+    ok &= checkGraph("disconnected grids", syntheticGraph(20, 3, false, rng), pairs, rng, totals, dir);
+    ok &= checkGraph("one-way streets", syntheticGraph(30, 1, true, rng), pairs, rng, totals, dir);
+
+    // a real piece of the NY map, once one is cut with --extract-subset and checked in
+    if (filesystem::exists(subsetCo) && filesystem::exists(subsetGr)) {
+        DIMACSData subset = Graph::loadDIMACS(subsetCo, subsetGr);
+        if (subset.nodes.empty() || subset.edges.empty()) {
+            cout << "FAIL: could not load the NY subset " << subsetCo << endl;
+            ok = false;
+        } else {
+            ok &= checkGraph("NY subset", subset, pairs, rng, totals, dir);
+        }
+    } else {
+        cout << "\nNo NY subset at " << subsetCo << ", only the generated graphs were checked" << endl;
+    }
+
+    error_code ignored;
+    filesystem::remove_all(dir, ignored);
+
+    // times are compared to plain dijkstra on the same pairs so the limits don't depend on the machine,
+    // an algorithm fails once its ratio is more than tolerance times the recorded one
+    auto reference = find_if(totals.begin(), totals.end(), [](const CheckAlgorithm& t) { return t.name == "Dijkstra"; });
+    double referenceMs = reference->totalMs / max(reference->queries, 1);
+
+    cout << "\n===== SELF CHECK =====" << endl;
+    for (auto& t : totals) {
+        double average = t.totalMs / max(t.queries, 1);
+        double ratio = average / referenceMs;
+        bool slow = t.baselineRatio > 0 && ratio > t.baselineRatio * tolerance;
+        ok &= !slow;
+        cout << t.name << ": " << average << " ms/query";
+        if (t.baselineRatio > 0) {
+            cout << " (" << ratio << "x dijkstra, limit " << t.baselineRatio * tolerance << "x)";
+        }
+        cout << ", " << t.mismatches << " mismatches" << (slow ? "  TOO SLOW" : "") << endl;
+    }
+    cout << "Tolerance: " << tolerance << "x the recorded ratios" << endl;
+    cout << (ok ? "PASS" : "FAIL") << endl;
+    cout << "======================" << endl;
+    return ok ? 0 : 1;
+}
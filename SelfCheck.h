@@ -0,0 +1,19 @@
+#include "Graph.h"
+using namespace std;
+
+#ifndef PROJECT3_SELFCHECK_H
+#define PROJECT3_SELFCHECK_H
+
+// Cross checks every search algorithm against plain dijkstra on seeded random pairs.
+// Runs on small generated DIMACS graphs (disconnected, one-way streets, isolated
+// nodes) plus the piece of the NY map in subsetCo/subsetGr if it's there.
+// Each algorithm's time per query is compared to plain dijkstra's on the same pairs,
+// it fails if that ratio is more than tolerance times its recorded ratio.
+// Returns 0 when everything agrees and none of them got slower.
+int runSelfCheck(const string& subsetCo, const string& subsetGr, int pairs, double tolerance);
+
+// writes the middle of a map (fraction of its width and height) as a new .co/.gr pair
+bool extractSubset(const string& coFile, const string& grFile, const string& outCo, const string& outGr,
+                   double fraction);
+
+#endif //PROJECT3_SELFCHECK_H
@@ -0,0 +1,646 @@
+#include "TiledGraph.h"
+#include <iostream>
+#include <filesystem>
+#include <limits>
+#include <climits>
+#include <algorithm>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+using namespace std;
+
+// arcs are buffered per tile while building and flushed to disk past this many ints
+const size_t BUILD_FLUSH_INTS = 3 * 4000000;
+// tiles kept in memory while the component index is built
+const size_t BUILD_TILE_CACHE_BYTES = 64 * 1024 * 1024;
+
+static string tilePath(const string& dir, int t) {
+    return dir + "/tile_" + to_string(t) + ".bin";
+}
+
+static string arcTempPath(const string& dir, int t) {
+    return dir + "/arcs_" + to_string(t) + ".tmp";
+}
+
+static string statePath(const string& dir, int t) {
+    return dir + "/state_" + to_string(t) + ".tmp";
+}
+
+static void writeInts(ofstream& out, const vector<int>& values) {
+    out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(int));
+}
+
+// false if the file ended (or failed) before count ints were read
+static bool readInts(ifstream& in, vector<int>& values, size_t count) {
+    values.resize(count);
+    in.read(reinterpret_cast<char*>(values.data()), count * sizeof(int));
+    return (size_t)in.gcount() == count * sizeof(int);
+}
+
+static void flushArcBuffers(const string& dir, vector<vector<int>>& buffers) {
+    for (int t = 0; t < (int)buffers.size(); t++) {
+        if (buffers[t].empty()) {
+            continue;
+        }
+        ofstream out(arcTempPath(dir, t), ios::binary | ios::app);
+        writeInts(out, buffers[t]);
+        vector<int>().swap(buffers[t]);
+    }
+}
+
+bool TiledGraph::build(const string& coFile, const string& grFile, const string& dir, int gridSize) {
+    filesystem::create_directories(dir);
+
+    // pass 1: coordinates, 0-indexed like Graph::loadCoordinates
+    vector<int> xs, ys;
+    ifstream co(coFile);
+    if (!co.is_open()) {
+        cerr << "Error: Could not open coordinate file: " << coFile << endl;
+        return false;
+    }
+    string line;
+    while (getline(co, line)) {
+        if (line.empty() || line[0] != 'v') {
+            continue;
+        }
+        char type;
+        int id, x, y;
+        istringstream iss(line);
+        iss >> type >> id >> x >> y;
+        id--;
+        if (id >= (int)xs.size()) {
+            xs.resize(id + 1);
+            ys.resize(id + 1);
+        }
+        xs[id] = x;
+        ys[id] = y;
+    }
+    co.close();
+
+    int nodes = xs.size();
+    if (nodes == 0) {
+        cerr << "Error: No coordinates in " << coFile << endl;
+        return false;
+    }
+    int minX = *min_element(xs.begin(), xs.end());
+    int maxX = *max_element(xs.begin(), xs.end());
+    int minY = *min_element(ys.begin(), ys.end());
+    int maxY = *max_element(ys.begin(), ys.end());
+
+    // assign every node to a grid cell and renumber so each tile is contiguous
+    int tiles = gridSize * gridSize;
+    vector<int> tileOfNode(nodes);
+    vector<int> tileStart(tiles + 1, 0);
+    for (int i = 0; i < nodes; i++) {
+        int gx = (int)((long long)(xs[i] - minX) * gridSize / ((long long)maxX - minX + 1));
+        int gy = (int)((long long)(ys[i] - minY) * gridSize / ((long long)maxY - minY + 1));
+        tileOfNode[i] = gy * gridSize + gx;
+        tileStart[tileOfNode[i] + 1]++;
+    }
+    for (int t = 0; t < tiles; t++) {
+        tileStart[t + 1] += tileStart[t];
+    }
+
+    vector<int> newId(nodes);
+    vector<int> oldId(nodes);
+    vector<int> next(tileStart.begin(), tileStart.end() - 1);
+    for (int i = 0; i < nodes; i++) {
+        newId[i] = next[tileOfNode[i]]++;
+        oldId[newId[i]] = i;
+    }
+
+    ofstream permOut(dir + "/perm.bin", ios::binary);
+    writeInts(permOut, newId);
+    permOut.close();
+    ofstream inversePermOut(dir + "/iperm.bin", ios::binary);
+    writeInts(inversePermOut, oldId);
+    inversePermOut.close();
+
+    // pass 2: stream the arcs into per tile temp files
+    for (int t = 0; t < tiles; t++) {
+        filesystem::remove(arcTempPath(dir, t));
+    }
+    // an index left from an older build must not get paired with the new tiles
+    filesystem::remove(dir + "/scc.bin");
+    filesystem::remove(dir + "/wcc.bin");
+
+    ifstream gr(grFile);
+    if (!gr.is_open()) {
+        cerr << "Error: Could not open graph file: " << grFile << endl;
+        return false;
+    }
+    vector<vector<int>> buffers(tiles);
+    size_t buffered = 0;
+    int arcs = 0;
+    // smallest weight per unit of straight line length, keeps the A* heuristic admissible
+    double scale = numeric_limits<double>::infinity();
+    while (getline(gr, line)) {
+        if (line.empty() || line[0] != 'a') {
+            continue;
+        }
+        char type;
+        int src, dest, weight;
+        istringstream iss(line);
+        iss >> type >> src >> dest >> weight;
+        src--;
+        dest--;
+        if (src < 0 || src >= nodes || dest < 0 || dest >= nodes) {
+            continue;
+        }
+
+        double dx = (double)xs[src] - xs[dest];
+        double dy = (double)ys[src] - ys[dest];
+        double length = sqrt(dx * dx + dy * dy);
+        if (length > 0) {
+            scale = min(scale, weight / length);
+        }
+
+        vector<int>& buffer = buffers[tileOfNode[src]];
+        buffer.push_back(newId[src]);
+        buffer.push_back(newId[dest]);
+        buffer.push_back(weight);
+        buffered += 3;
+        arcs++;
+        if (buffered >= BUILD_FLUSH_INTS) {
+            flushArcBuffers(dir, buffers);
+            buffered = 0;
+        }
+    }
+    gr.close();
+    flushArcBuffers(dir, buffers);
+    if (scale == numeric_limits<double>::infinity()) {
+        scale = 0;
+    }
+
+    // pass 3: turn each temp file into a CSR tile
+    for (int t = 0; t < tiles; t++) {
+        Tile tile;
+        int first = tileStart[t];
+        int count = tileStart[t + 1] - first;
+
+        vector<int> raw;
+        ifstream in(arcTempPath(dir, t), ios::binary | ios::ate);
+        if (in.is_open()) {
+            size_t size = in.tellg();
+            in.seekg(0);
+            readInts(in, raw, size / sizeof(int));
+            in.close();
+            filesystem::remove(arcTempPath(dir, t));
+        }
+        int tileArcs = raw.size() / 3;
+
+        tile.offsets.assign(count + 1, 0);
+        for (int i = 0; i < tileArcs; i++) {
+            tile.offsets[raw[3 * i] - first + 1]++;
+        }
+        for (int i = 0; i < count; i++) {
+            tile.offsets[i + 1] += tile.offsets[i];
+        }
+        tile.targets.resize(tileArcs);
+        tile.weights.resize(tileArcs);
+        vector<int> fill(tile.offsets.begin(), tile.offsets.end() - 1);
+        for (int i = 0; i < tileArcs; i++) {
+            int pos = fill[raw[3 * i] - first]++;
+            tile.targets[pos] = raw[3 * i + 1];
+            tile.weights[pos] = raw[3 * i + 2];
+        }
+        tile.x.resize(count);
+        tile.y.resize(count);
+        for (int i = 0; i < count; i++) {
+            tile.x[i] = xs[oldId[first + i]];
+            tile.y[i] = ys[oldId[first + i]];
+        }
+
+        ofstream out(tilePath(dir, t), ios::binary);
+        int header[3] = {first, count, tileArcs};
+        out.write(reinterpret_cast<const char*>(header), sizeof(header));
+        writeInts(out, tile.offsets);
+        writeInts(out, tile.targets);
+        writeInts(out, tile.weights);
+        writeInts(out, tile.x);
+        writeInts(out, tile.y);
+    }
+
+    ofstream meta(dir + "/meta.bin", ios::binary);
+    int header[4] = {nodes, arcs, gridSize, tiles};
+    meta.write(reinterpret_cast<const char*>(header), sizeof(header));
+    meta.write(reinterpret_cast<const char*>(&scale), sizeof(scale));
+    writeInts(meta, tileStart);
+    meta.close();
+
+    // component index in tiled ids, queries read the two ids of src and dest with seeks
+    // like the permutation, so unreachable pairs are rejected without paging in any tiles
+    // the arcs come from the tiles just written, paged through the LRU cache like a query does,
+    // so only the per node arrays of the search are in memory
+    vector<int>().swap(xs);
+    vector<int>().swap(ys);
+    vector<int>().swap(newId);
+    vector<int>().swap(oldId);
+    vector<int>().swap(tileOfNode);
+    TiledGraph paged;
+    if (!paged.openTiles(dir, BUILD_TILE_CACHE_BYTES)) {
+        return false;
+    }
+    const Tile* lastTile = nullptr;    // valid until the next tile is loaded, which only happens below
+    Components components = findComponents(nodes, [&](int v, int i) {
+        if (!lastTile || v < lastTile->firstNode || v >= lastTile->firstNode + (int)lastTile->offsets.size() - 1) {
+            lastTile = paged.getTile(paged.tileOf(v));
+            if (!lastTile) {
+                return -1;
+            }
+        }
+        int arc = lastTile->offsets[v - lastTile->firstNode] + i;
+        return arc < lastTile->offsets[v - lastTile->firstNode + 1] ? lastTile->targets[arc] : -1;
+    });
+    if (paged.ioFailed) {
+        cerr << "Error: Could not read the tiles back in " << dir << endl;
+        return false;
+    }
+    cout << "Component index paged in " << paged.stats.pageIns << " tiles" << endl;
+    ofstream componentsOut(dir + "/scc.bin", ios::binary);
+    writeInts(componentsOut, components.sccOf);
+    componentsOut.close();
+    componentsOut.open(dir + "/wcc.bin", ios::binary);
+    writeInts(componentsOut, components.wccOf);
+    componentsOut.close();
+    cout << "Components: " << components.numSCCs << " strongly connected (largest has "
+         << components.largestSCCSize << " of " << nodes << " nodes), " << components.numWCCs << " weakly connected"
+         << endl;
+
+    cout << "Built " << tiles << " tiles (" << nodes << " nodes, " << arcs << " arcs) in " << dir << endl;
+    cout << "Peak memory: " << peakMemoryKB() / 1024 << " MB" << endl;
+    return true;
+}
+
+bool TiledGraph::open(const string& dir, size_t budgetBytes) {
+    if (!openTiles(dir, budgetBytes)) {
+        return false;
+    }
+    permFile.open(dir + "/perm.bin", ios::binary);
+    inversePermFile.open(dir + "/iperm.bin", ios::binary);
+    if (!permFile.is_open() || !inversePermFile.is_open()) {
+        cerr << "Error: Missing node permutation in " << dir << endl;
+        return false;
+    }
+    sccFile.open(dir + "/scc.bin", ios::binary);
+    wccFile.open(dir + "/wcc.bin", ios::binary);
+    if (!sccFile.is_open() || !wccFile.is_open()) {
+        cerr << "Error: Missing component index in " << dir << ", rebuild the tiles" << endl;
+        return false;
+    }
+
+    cout << "Opened " << numTiles << " tiles (" << numNodes << " nodes, " << numArcs << " arcs), memory budget "
+         << cacheLimit / 1024 << " KB" << endl;
+    return true;
+}
+
+bool TiledGraph::openTiles(const string& dir, size_t budgetBytes) {
+    ifstream meta(dir + "/meta.bin", ios::binary);
+    if (!meta.is_open()) {
+        cerr << "Error: Could not open tile directory: " << dir << endl;
+        return false;
+    }
+    int header[4] = {0, 0, 0, 0};
+    meta.read(reinterpret_cast<char*>(header), sizeof(header));
+    meta.read(reinterpret_cast<char*>(&heuristicScale), sizeof(heuristicScale));
+    if (!meta || header[3] <= 0 || !readInts(meta, tileStart, header[3] + 1) || tileStart.back() != header[0]) {
+        cerr << "Error: Damaged meta.bin in " << dir << endl;
+        return false;
+    }
+    numNodes = header[0];
+    numArcs = header[1];
+    numTiles = header[3];
+    meta.close();
+
+    tileDir = dir;
+    cacheLimit = budgetBytes;
+    cacheUsed = 0;
+    openSetBytes = 0;
+    lru.clear();
+    cache.clear();
+    stateSpilled.assign(numTiles, false);
+    return true;
+}
+
+int TiledGraph::readInt(ifstream& file, int index) {
+    int value = -1;
+    file.clear();
+    file.seekg((streamoff)index * sizeof(int));
+    if (!file.read(reinterpret_cast<char*>(&value), sizeof(int))) {
+        cerr << "Error: Could not read entry " << index << " of an index file in " << tileDir << endl;
+        ioFailed = true;
+        return -1;
+    }
+    return value;
+}
+
+bool TiledGraph::mayReach(int s, int d) {
+    if (s == d) {
+        return true;
+    }
+    int wccS = readInt(wccFile, s);
+    int wccD = readInt(wccFile, d);
+    int sccS = readInt(sccFile, s);
+    int sccD = readInt(sccFile, d);
+    // a failed read sets ioFailed, leave it to the caller to report
+    return ioFailed || (wccS == wccD && sccS >= sccD);
+}
+
+int TiledGraph::tileOf(int tiledId) const {
+    return upper_bound(tileStart.begin(), tileStart.end(), tiledId) - tileStart.begin() - 1;
+}
+
+void TiledGraph::evictToBudget(size_t incoming, size_t keep) {
+    // evict from the back, but keep the most recently used tiles the caller still needs
+    while (cacheUsed + openSetBytes + incoming > cacheLimit && lru.size() > keep) {
+        int victim = lru.back();
+        lru.pop_back();
+        CachedTile& entry = cache[victim];
+
+        // the search state would be lost, write it out and read it back if the search comes back here
+        if (!entry.search.g.empty()) {
+            ofstream out(statePath(tileDir, victim), ios::binary);
+            writeInts(out, entry.search.g);
+            writeInts(out, entry.search.parent);
+            out.write(entry.search.closed.data(), entry.search.closed.size());
+            if (!out) {
+                cerr << "Error: Could not write search state to " << statePath(tileDir, victim) << endl;
+                ioFailed = true;
+            }
+            stateSpilled[victim] = true;
+            stats.stateSpills++;
+        }
+
+        cacheUsed -= entry.tile.bytes() + entry.search.bytes();
+        cache.erase(victim);
+        stats.evictions++;
+    }
+    if (cacheUsed + openSetBytes + incoming > cacheLimit) {
+        stats.overBudget = true;
+    }
+    stats.peakBudgetBytes = max(stats.peakBudgetBytes, cacheUsed + openSetBytes + incoming);
+}
+
+TiledGraph::CachedTile* TiledGraph::loadTile(int t) {
+    auto it = cache.find(t);
+    if (it != cache.end()) {
+        lru.splice(lru.begin(), lru, it->second.lruPos);
+        return &it->second;
+    }
+    if (t < 0 || t >= numTiles) {
+        cerr << "Error: No tile " << t << " in " << tileDir << endl;
+        ioFailed = true;
+        return nullptr;
+    }
+
+    // page the tile in, checking it against meta.bin so a damaged file can't send the search out of bounds
+    string path = tilePath(tileDir, t);
+    ifstream in(path, ios::binary);
+    if (!in.is_open()) {
+        cerr << "Error: Could not open tile: " << path << endl;
+        ioFailed = true;
+        return nullptr;
+    }
+    int count = tileStart[t + 1] - tileStart[t];
+    int header[3] = {0, 0, 0};
+    in.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (in.gcount() != sizeof(header) || header[0] != tileStart[t] || header[1] != count || header[2] < 0 ||
+        header[2] > numArcs) {
+        cerr << "Error: Bad tile header in " << path << endl;
+        ioFailed = true;
+        return nullptr;
+    }
+
+    // make room first so the budget holds while the tile is read
+    size_t bytes = (size_t)(3 * count + 1 + 2 * header[2]) * sizeof(int);
+    evictToBudget(bytes, 0);
+
+    Tile tile;
+    tile.firstNode = header[0];
+    bool complete = readInts(in, tile.offsets, count + 1) && readInts(in, tile.targets, header[2]) &&
+                    readInts(in, tile.weights, header[2]) && readInts(in, tile.x, count) && readInts(in, tile.y, count);
+    if (!complete || tile.offsets[0] != 0 || tile.offsets[count] != header[2]) {
+        cerr << "Error: Tile is truncated or damaged: " << path << endl;
+        ioFailed = true;
+        return nullptr;
+    }
+    stats.pageIns++;
+
+    cacheUsed += tile.bytes();
+    lru.push_front(t);
+    CachedTile& entry = cache[t];
+    entry.tile = move(tile);
+    entry.lruPos = lru.begin();
+    return &entry;
+}
+
+const Tile* TiledGraph::getTile(int t) {
+    CachedTile* entry = loadTile(t);
+    return entry == nullptr ? nullptr : &entry->tile;
+}
+
+TileSearchState* TiledGraph::getSearchState(int t) {
+    CachedTile* entry = loadTile(t);
+    if (entry == nullptr) {
+        return nullptr;
+    }
+    TileSearchState& search = entry->search;
+    int count = entry->tile.x.size();
+    if (!search.g.empty() || count == 0) {
+        return &search;
+    }
+
+    evictToBudget((size_t)count * (2 * sizeof(int) + 1), 1);
+    if (stateSpilled[t]) {
+        ifstream in(statePath(tileDir, t), ios::binary);
+        search.closed.resize(count);
+        if (!readInts(in, search.g, count) || !readInts(in, search.parent, count) ||
+            !in.read(search.closed.data(), count)) {
+            cerr << "Error: Could not read search state back from " << statePath(tileDir, t) << endl;
+            ioFailed = true;
+            search = TileSearchState();
+            return nullptr;
+        }
+        stats.stateReloads++;
+    } else {
+        search.g.assign(count, INT_MAX);
+        search.parent.assign(count, -1);
+        search.closed.assign(count, 0);
+    }
+    cacheUsed += search.bytes();
+    return &search;
+}
+
+void TiledGraph::clearSearchState() {
+    for (auto& entry : cache) {
+        cacheUsed -= entry.second.search.bytes();
+        entry.second.search = TileSearchState();
+    }
+    for (int t = 0; t < numTiles; t++) {
+        if (stateSpilled[t]) {
+            error_code ignored;
+            filesystem::remove(statePath(tileDir, t), ignored);
+        }
+    }
+    stateSpilled.assign(numTiles, false);
+    openSetBytes = 0;
+}
+
+vector<int> TiledGraph::aStarPath(int src, int dest, int& distance) {
+    vector<int> path;
+    distance = -1;
+    stats = TiledStats();
+    ioFailed = false;
+    if (src < 0 || src >= numNodes || dest < 0 || dest >= numNodes) {
+        return path;
+    }
+    clearSearchState();
+
+    int s = readInt(permFile, src);
+    int d = readInt(permFile, dest);
+    bool reachable = !ioFailed && mayReach(s, d);
+    if (ioFailed || !reachable) {
+        stats.ruledOut = !ioFailed;
+        stats.peakMemoryKB = peakMemoryKB();
+        return path;
+    }
+
+    const Tile* destTile = getTile(tileOf(d));
+    if (destTile == nullptr) {
+        return path;
+    }
+    double destX = destTile->x[d - destTile->firstNode];
+    double destY = destTile->y[d - destTile->firstNode];
+
+    // these return 0 / nullptr when a tile can't be read, ioFailed is set then and the search stops
+    auto heuristic = [&](int node) -> double {
+        const Tile* tile = getTile(tileOf(node));
+        if (tile == nullptr) {
+            return 0;
+        }
+        double dx = tile->x[node - tile->firstNode] - destX;
+        double dy = tile->y[node - tile->firstNode] - destY;
+        return sqrt(dx * dx + dy * dy) * heuristicScale;
+    };
+
+    // g, parent and closed of a node, read through the tile cache
+    auto state = [&](int node) -> pair<TileSearchState*, int> {
+        int t = tileOf(node);
+        return {getSearchState(t), node - tileStart[t]};
+    };
+
+    // the open set shares the budget, the cache shrinks while the frontier grows
+    typedef pair<double, int> OpenEntry;
+    priority_queue<OpenEntry, vector<OpenEntry>, greater<OpenEntry>> openSet;
+    auto push = [&](double f, int node) {
+        evictToBudget(sizeof(OpenEntry), 1);
+        openSet.push({f, node});
+        openSetBytes = openSet.size() * sizeof(OpenEntry);
+        stats.peakOpenSetBytes = max(stats.peakOpenSetBytes, openSetBytes);
+    };
+    vector<pair<int, int>> arcs;
+
+    auto start = state(s);
+    if (start.first != nullptr) {
+        start.first->g[start.second] = 0;
+        push(heuristic(s), s);
+    }
+
+    bool found = false;
+    while (!openSet.empty() && !ioFailed && !stats.overBudget) {
+        int current = openSet.top().second;
+        openSet.pop();
+        openSetBytes = openSet.size() * sizeof(OpenEntry);
+
+        auto node = state(current);
+        if (node.first == nullptr) {
+            break;
+        }
+        if (node.first->closed[node.second]) {
+            continue;
+        }
+        if (current == d) {
+            found = true;
+            break;
+        }
+        node.first->closed[node.second] = 1;
+        int g = node.first->g[node.second];
+        stats.settled++;
+
+        // copy the arcs out, looking up neighbor coords can evict this tile
+        const Tile* tile = getTile(tileOf(current));
+        if (tile == nullptr) {
+            break;
+        }
+        int local = current - tile->firstNode;
+        arcs.clear();
+        for (int i = tile->offsets[local]; i < tile->offsets[local + 1]; i++) {
+            arcs.push_back({tile->targets[i], tile->weights[i]});
+        }
+
+        for (auto& arc : arcs) {
+            auto next = state(arc.first);
+            if (next.first == nullptr) {
+                break;
+            }
+            if (next.first->closed[next.second] || g + arc.second >= next.first->g[next.second]) {
+                continue;
+            }
+            next.first->g[next.second] = g + arc.second;
+            next.first->parent[next.second] = current;
+            push(g + arc.second + heuristic(arc.first), arc.first);
+        }
+    }
+    openSetBytes = 0;
+    if (stats.overBudget) {
+        cerr << "Error: the search needs more than the memory budget (open set "
+             << stats.peakOpenSetBytes / 1024 << " KB)" << endl;
+        found = false;
+    }
+
+    if (found && !ioFailed) {
+        auto target = state(d);
+        distance = target.first == nullptr ? -1 : target.first->g[target.second];
+
+        // build the path backwards and map it back to the original ids
+        int node = d;
+        while (node != -1 && !ioFailed) {
+            path.push_back(readInt(inversePermFile, node));
+            auto at = state(node);
+            node = at.first == nullptr ? -1 : at.first->parent[at.second];
+        }
+        reverse(path.begin(), path.end());
+    }
+    if (ioFailed) {
+        cerr << "Error: Tiled query " << src << " -> " << dest << " failed, the tile files can't be read" << endl;
+        path.clear();
+        distance = -1;
+    }
+
+    clearSearchState();
+    stats.peakMemoryKB = peakMemoryKB();
+    return path;
+}
+
+long TiledGraph::peakMemoryKB() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return (long)(counters.PeakWorkingSetSize / 1024);
+    }
+    return 0;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    // macOS reports bytes, Linux reports KB
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
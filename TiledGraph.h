@@ -0,0 +1,121 @@
+#include <list>
+#include <unordered_map>
+#include "Graph.h"
+using namespace std;
+
+#ifndef PROJECT3_TILEDGRAPH_H
+#define PROJECT3_TILEDGRAPH_H
+
+// One spatial tile of the graph, stored on disk as a small CSR block.
+// Nodes are renumbered so every tile owns a contiguous range of ids,
+// that way the owning tile can be found from the id alone.
+struct Tile {
+    int firstNode = 0;
+    vector<int> offsets;   // arcs of local node i are [offsets[i], offsets[i+1])
+    vector<int> targets;   // tiled ids of the arc heads
+    vector<int> weights;
+    vector<int> x, y;      // raw DIMACS coordinates of each local node
+
+    size_t bytes() const {
+        return (offsets.size() + targets.size() + weights.size() + x.size() + y.size()) * sizeof(int);
+    }
+};
+
+// search state of the nodes in one tile, only allocated for tiles the current query touches
+// lives in the LRU next to its tile and gets written to disk when the tile is evicted
+struct TileSearchState {
+    vector<int> g;
+    vector<int> parent;
+    vector<char> closed;
+
+    size_t bytes() const {
+        return (g.size() + parent.size()) * sizeof(int) + closed.size();
+    }
+};
+
+// counters from the last query
+struct TiledStats {
+    long long pageIns = 0;
+    long long evictions = 0;
+    long long stateSpills = 0;     // search states written to disk on eviction
+    long long stateReloads = 0;    // and read back later
+    long long settled = 0;
+    size_t peakBudgetBytes = 0;    // tiles + search state + open set, only above the budget with overBudget
+    size_t peakOpenSetBytes = 0;
+    bool overBudget = false;       // no room left even after evicting, the query was stopped
+    bool ruledOut = false;         // the component index says there is no path, nothing was searched
+    long peakMemoryKB = 0;
+};
+
+// Out-of-core graph for datasets that don't fit in RAM (like USA-road-d.USA).
+// build() partitions the graph into a grid of tiles on disk once, then
+// searches page tiles and their search state in through a bounded LRU cache.
+class TiledGraph {
+public:
+    int numNodes = 0;
+    int numArcs = 0;
+    int numTiles = 0;
+    TiledStats stats;
+
+    // preprocessing: writes the tiles for coFile/grFile into dir, then the component index
+    // by paging those tiles back in, so no step holds every arc in memory
+    static bool build(const string& coFile, const string& grFile, const string& dir, int gridSize);
+
+    // opens a tile directory, budgetBytes covers paged in tiles, the per node
+    // search state and the open set of a query
+    bool open(const string& dir, size_t budgetBytes);
+
+    // A* over the tiles, src/dest/path use the original 0-indexed node ids
+    // distance is set to the path cost, or -1 if there is no path, stats.overBudget is set
+    // or the tile files can't be read (printed to cerr)
+    vector<int> aStarPath(int src, int dest, int& distance);
+
+    // peak resident memory of this process in KB
+    static long peakMemoryKB();
+
+private:
+    // the part of open() that build() needs: meta.bin and an empty cache
+    bool openTiles(const string& dir, size_t budgetBytes);
+
+    string tileDir;
+    size_t cacheLimit = 0;
+    size_t cacheUsed = 0;         // tiles and search states in the cache
+    size_t openSetBytes = 0;      // open set of the running query, counts against the same budget
+    double heuristicScale = 0;    // min(weight / straight line length) over all arcs
+    vector<int> tileStart;        // first tiled id of each tile, plus numNodes at the end
+
+    struct CachedTile {
+        Tile tile;
+        TileSearchState search;
+        list<int>::iterator lruPos;
+    };
+
+    // LRU cache, most recently used tile at the front
+    list<int> lru;
+    unordered_map<int, CachedTile> cache;
+    vector<bool> stateSpilled;    // tiles whose search state is on disk for the running query
+
+    // old id -> tiled id and back, read with seeks so they never live in RAM
+    ifstream permFile;
+    ifstream inversePermFile;
+    // scc and wcc id of every tiled id (see findComponents), read the same way
+    ifstream sccFile;
+    ifstream wccFile;
+
+    // these return nullptr and set ioFailed if a tile or spilled state can't be read
+    // the pointer stays valid until the next tile is loaded or the open set grows
+    CachedTile* loadTile(int t);
+    const Tile* getTile(int t);
+    TileSearchState* getSearchState(int t);
+    // makes room for incoming more bytes, never evicts the keep most recently used tiles
+    void evictToBudget(size_t incoming, size_t keep);
+    void clearSearchState();
+    bool ioFailed = false;
+    int tileOf(int tiledId) const;
+    // same check as Graph::mayReach on tiled ids, false means there is definitely no path
+    bool mayReach(int s, int d);
+    int readInt(ifstream& file, int index);
+};
+
+
+#endif //PROJECT3_TILEDGRAPH_H
@@ -4,18 +4,222 @@
 #include <cmath>
 #include <map>
 #include <chrono>
+#include <random>
 #include "Graph.h"
+#include "TiledGraph.h"
+#include "SelfCheck.h"
+#include "Benchmark.h"
 
 using namespace std;
 
 const string CO_FILE = "../USA-road-d.NY.co";
 const string GR_FILE = "../USA-road-d.NY.gr";
+const string TIME_FILE = "../USA-road-t.NY.gr";
+
+// piece of the NY map for the self check (cut with --extract-subset), CMake points this at the source tree
+#ifndef TESTDATA_DIR
+#define TESTDATA_DIR "../testdata"
+#endif
+const string SUBSET_CO_FILE = string(TESTDATA_DIR) + "/NY-subset.co";
+const string SUBSET_GR_FILE = string(TESTDATA_DIR) + "/NY-subset.gr";
 
 const int WIDTH = 1400;
 const int HEIGHT = 1400;
 const int PAD = 50;
 
-int main() {
+// average ms per query of search over the given (src, dest) pairs
+double averageQueryMs(const vector<pair<int, int>>& queries, const function<vector<int>(int, int)>& search) {
+    auto start = chrono::high_resolution_clock::now();
+    for (auto& q : queries) {
+        search(q.first, q.second);
+    }
+    auto end = chrono::high_resolution_clock::now();
+    return chrono::duration<double, milli>(end - start).count() / max<size_t>(queries.size(), 1);
+}
+
+// command line modes, these run without opening a window
+//   --tile-build <co> <gr> <dir> [grid]          split a graph into grid x grid tiles on disk
+//   --tile-route <dir> <src> <dest> [memoryMB]   route over the tiles within a memory budget
+//   --arc-flags [cells] [queries]                preprocess arc flags on NY and compare query times
+//   --selfcheck [pairs] [tolerance]              cross check all algorithms, fails on mismatch or slow queries
+//   --extract-subset <co> <gr> <outCo> <outGr> [fraction]  cut the middle of a map into a new .co/.gr pair
+//   --coord-bench [queries]                      memory and cache misses of the coordinate layouts
+//   --pareto <src> <dest> [maxLabels] [turnFile] distance/time trade-offs between two nodes
+//   --batch <src> [targets] [sources]            throughput of one-to-many and multi-source queries
+int runCommandLine(int argc, char* argv[]) {
+    string mode = argv[1];
+
+    if (mode == "--batch" && argc >= 3) {
+        int numTargets = argc >= 4 ? stoi(argv[3]) : 100;
+        int numSources = argc >= 5 ? stoi(argv[4]) : 16;
+        return runBatchBenchmark(CO_FILE, GR_FILE, stoi(argv[2]), numTargets, numSources);
+    }
+
+    if (mode == "--pareto" && argc >= 4) {
+        int src = stoi(argv[2]);
+        int dest = stoi(argv[3]);
+
+        DIMACSData data = Graph::loadDIMACS(CO_FILE, GR_FILE);
+        int numNodes, numEdges;
+        vector<Edge> times = Graph::loadEdges(TIME_FILE, numNodes, numEdges);
+        Graph graph(data.edges, data.numNodes);
+        if (!graph.addWeights(times)) {
+            return 1;
+        }
+        if (argc >= 6 && !graph.loadTurnCosts(argv[5])) {
+            return 1;
+        }
+
+        // criterion 0 is distance, 1 is travel time
+        MultiCriteriaOptions fastest;
+        fastest.criteria = {1, 0};
+        fastest.paretoFront = false;
+        MultiCriteriaOptions front;
+        front.criteria = {1, 0};
+        front.maxLabelsPerNode = argc >= 5 ? stoi(argv[4]) : 32;
+
+        cout << "\n===== MULTI-CRITERIA =====" << endl;
+        auto start = chrono::high_resolution_clock::now();
+        vector<ParetoPath> best = graph.multiCriteriaPaths(src, dest, fastest);
+        auto end = chrono::high_resolution_clock::now();
+        if (best.empty()) {
+            cout << "No path found!" << endl;
+            return 1;
+        }
+        cout << "Fastest (distance as tie-breaker): time " << best[0].costs[0] << ", distance " << best[0].costs[1]
+             << ", " << best[0].path.size() << " nodes, "
+             << chrono::duration_cast<chrono::milliseconds>(end - start).count() << " ms" << endl;
+
+        start = chrono::high_resolution_clock::now();
+        vector<ParetoPath> results = graph.multiCriteriaPaths(src, dest, front);
+        end = chrono::high_resolution_clock::now();
+        cout << "\nPareto front: " << results.size() << " paths, "
+             << chrono::duration_cast<chrono::milliseconds>(end - start).count() << " ms" << endl;
+        for (auto& result : results) {
+            cout << "  time " << result.costs[0] << ", distance " << result.costs[1] << endl;
+        }
+        cout << "==========================" << endl;
+        return 0;
+    }
+
+    if (mode == "--coord-bench") {
+        int queries = argc >= 3 ? stoi(argv[2]) : 100;
+        return runCoordBenchmark(CO_FILE, GR_FILE, queries);
+    }
+
+    if (mode == "--selfcheck") {
+        int pairs = argc >= 3 ? stoi(argv[2]) : 2000;
+        double tolerance = argc >= 4 ? stod(argv[3]) : 2;
+        return runSelfCheck(SUBSET_CO_FILE, SUBSET_GR_FILE, pairs, tolerance);
+    }
+
+    if (mode == "--extract-subset" && argc >= 6) {
+        double fraction = argc >= 7 ? stod(argv[6]) : 0.1;
+        return extractSubset(argv[2], argv[3], argv[4], argv[5], fraction) ? 0 : 1;
+    }
+
+    if (mode == "--arc-flags") {
+        int cells = argc >= 3 ? stoi(argv[2]) : 32;
+        int numQueries = argc >= 4 ? stoi(argv[3]) : 20;
+
+        DIMACSData data = Graph::loadDIMACS(CO_FILE, GR_FILE);
+        if (data.nodes.empty()) {
+            return 1;
+        }
+        Graph graph(data.edges, data.numNodes);
+
+        auto start = chrono::high_resolution_clock::now();
+        graph.computeArcFlags(data.nodes, cells);
+        auto end = chrono::high_resolution_clock::now();
+        cout << "Preprocessing: " << chrono::duration_cast<chrono::seconds>(end - start).count() << " s for "
+             << graph.numCells << " cells" << endl;
+
+        mt19937 rng(42);
+        uniform_int_distribution<int> pick(0, graph.numVertices - 1);
+        vector<pair<int, int>> queries;
+        for (int i = 0; i < numQueries; i++) {
+            queries.push_back({pick(rng), pick(rng)});
+        }
+
+        // dijkstraPath settles the whole graph, the early stop baseline is the same search as the
+        // arc flag one with the flags ignored, so the speedup over it comes from the pruning alone
+        double plain = averageQueryMs(queries, [&](int s, int d) { return graph.dijkstraPath(s, d); });
+        double earlyStop = averageQueryMs(queries, [&](int s, int d) { return graph.arcFlagDijkstraPath(s, d, false); });
+        double twoWay = averageQueryMs(queries, [&](int s, int d) { return graph.twoWayDijkstraPath(s, d); });
+        double flagged = averageQueryMs(queries, [&](int s, int d) { return graph.arcFlagDijkstraPath(s, d); });
+
+        cout << "\n===== ARC FLAGS (" << numQueries << " random queries) =====" << endl;
+        cout << "Flags: " << graph.flagBytes << " byte(s) per arc, "
+             << (graph.arcFlags.size() + graph.firstArc.size() * sizeof(int)) / 1024 << " KB total" << endl;
+        cout << "Dijkstra (full search):   " << plain << " ms/query" << endl;
+        cout << "Dijkstra (stops at dest): " << earlyStop << " ms/query" << endl;
+        cout << "Two-way Dijkstra:         " << twoWay << " ms/query" << endl;
+        cout << "Arc flag Dijkstra:        " << flagged << " ms/query" << endl;
+        cout << "Speedup from the flags: " << earlyStop / flagged << "x (vs full Dijkstra: " << plain / flagged
+             << "x, vs two-way: " << twoWay / flagged << "x)" << endl;
+        cout << "=========================" << endl;
+        return 0;
+    }
+
+    if (mode == "--tile-build" && argc >= 5) {
+        int grid = argc >= 6 ? stoi(argv[5]) : 64;
+        return TiledGraph::build(argv[2], argv[3], argv[4], grid) ? 0 : 1;
+    }
+
+    if (mode == "--tile-route" && argc >= 5) {
+        size_t memoryMB = argc >= 6 ? stoul(argv[5]) : 256;
+        TiledGraph tiled;
+        if (!tiled.open(argv[2], memoryMB * 1024 * 1024)) {
+            return 1;
+        }
+        int src = stoi(argv[3]);
+        int dest = stoi(argv[4]);
+
+        cout << "\n===== TILED A* =====" << endl;
+        int distance;
+        auto start = chrono::high_resolution_clock::now();
+        vector<int> path = tiled.aStarPath(src, dest, distance);
+        auto end = chrono::high_resolution_clock::now();
+        auto time = chrono::duration_cast<chrono::milliseconds>(end - start);
+
+        cout << "Time: " << time.count() << " ms" << endl;
+        cout << "Distance: " << distance << endl;
+        cout << "Path length: " << path.size() << " nodes" << endl;
+        cout << "Settled: " << tiled.stats.settled << " nodes" << endl;
+        cout << "Tile page-ins: " << tiled.stats.pageIns << " (evictions: " << tiled.stats.evictions << ")" << endl;
+        cout << "Search state spills: " << tiled.stats.stateSpills << " (reloads: " << tiled.stats.stateReloads << ")"
+             << endl;
+        cout << "Peak budgeted memory: " << tiled.stats.peakBudgetBytes / 1024 << " KB (open set "
+             << tiled.stats.peakOpenSetBytes / 1024 << " KB)" << endl;
+        cout << "Peak memory: " << tiled.stats.peakMemoryKB / 1024 << " MB" << endl;
+        if (tiled.stats.ruledOut) {
+            cout << "Ruled out by the component index, no tiles searched" << endl;
+        }
+        if (tiled.stats.overBudget) {
+            cout << "Stopped: over the memory budget" << endl;
+        }
+        cout << "====================" << endl;
+        return path.empty() ? 1 : 0;
+    }
+
+    cout << "Usage:" << endl;
+    cout << "  Project3                                         open the NY map viewer" << endl;
+    cout << "  Project3 --tile-build <co> <gr> <dir> [grid]     split a graph into tiles" << endl;
+    cout << "  Project3 --tile-route <dir> <src> <dest> [memoryMB]  route over the tiles" << endl;
+    cout << "  Project3 --arc-flags [cells] [queries]           arc flag speedup on NY" << endl;
+    cout << "  Project3 --selfcheck [pairs] [tolerance]         check all algorithms agree" << endl;
+    cout << "  Project3 --extract-subset <co> <gr> <outCo> <outGr> [fraction]  cut out the middle of a map" << endl;
+    cout << "  Project3 --coord-bench [queries]                 coordinate layout benchmark" << endl;
+    cout << "  Project3 --pareto <src> <dest> [maxLabels] [turnFile]  time/distance trade-offs" << endl;
+    cout << "  Project3 --batch <src> [targets] [sources]       batch query throughput" << endl;
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        return runCommandLine(argc, argv);
+    }
+
     sf::RenderWindow window(sf::VideoMode({WIDTH, HEIGHT}), "NY Roads - SPACE to find path");
 
     // load map
@@ -27,10 +231,6 @@ int main() {
         return 1;
     }
 
-    sort(data.nodes.begin(), data.nodes.end(), [](const NodeCoord& a, const NodeCoord& b) {
-        return a.id < b.id;
-    });
-
     // focus on a smaller region // testing different area sizes
     double fullRangeX = data.maxX - data.minX;
     double fullRangeY = data.maxY - data.minY;
@@ -92,6 +292,7 @@ int main() {
 
     // build full graph (need all edges for pathfinding)
     Graph graph(data.edges, data.numNodes);
+    CoordStore coords(data.nodes, graph);
 
     // path variables
     vector<int> path;
@@ -169,7 +370,7 @@ int main() {
                             // run A*
                             cout << "\n===== A* ALGORITHM =====" << endl;
                             auto start = chrono::high_resolution_clock::now();
-                            path = graph.aStarPath(src, dest, data.nodes);
+                            path = graph.aStarPath(src, dest, coords);
                             auto end = chrono::high_resolution_clock::now();
                             auto time = chrono::duration_cast<chrono::milliseconds>(end - start);
 